@@ -0,0 +1,95 @@
+#include "bridge/MappingExpression.h"
+#include "bridge/NoteOffScheduler.h"
+#include "bridge/SceneMorph.h"
+#include "bridge/UniversalMidiPacket.h"
+#include "catch2/benchmark/catch_benchmark_all.hpp"
+#include "catch2/catch_test_macros.hpp"
+
+TEST_CASE ("MIDI output performance")
+{
+    // A block's worth of MIDI 2.0 controller and note packets
+    std::vector<birdhouse::ump::Packet64> packets;
+    for (auto i = 0; i < 512; ++i)
+    {
+        const auto value = birdhouse::ump::toUint32 (static_cast<float> (i) / 511.0f);
+        packets.push_back (i % 4 == 0 ? birdhouse::ump::makeNoteOn (1, 60, static_cast<juce::uint16> (value >> 16))
+                                      : birdhouse::ump::makeControlChange (1 + i % 16, i % 128, value));
+    }
+
+    birdhouse::ump::Midi1Downconverter downconverter;
+    juce::MidiBuffer midi;
+
+    BENCHMARK ("Downconvert 512 UMP packets to MIDI 1.0")
+    {
+        midi.clear();
+        downconverter.convert (packets.data(), static_cast<int> (packets.size()), [&midi] (const juce::uint8* bytes, int numBytes) {
+            midi.addEvent (bytes, numBytes, 0);
+        });
+        return midi.getNumEvents();
+    };
+}
+
+TEST_CASE ("Note off scheduling performance")
+{
+    birdhouse::NoteOffScheduler scheduler;
+    scheduler.prepare (48000.0);
+
+    // Thousands of notes with lengths between 10 ms and 10 s pending at any time
+    const auto numNotes = 4000;
+    juce::Random random (1);
+    auto numReleased = 0;
+
+    for (auto i = 0; i < numNotes; ++i)
+    {
+        const juce::uint8 noteOn[3] = { static_cast<juce::uint8> (0x90 | (i % 16)), static_cast<juce::uint8> (i % 128), 100 };
+        scheduler.handleWrittenMessage (0, noteOn, 3, 0, 10.0f + random.nextFloat() * 10000.0f);
+    }
+
+    BENCHMARK ("Advance 512 samples with 4000 pending note offs")
+    {
+        scheduler.advance (512, [&numReleased] (int, const birdhouse::MidiEvent&, int) { numReleased++; });
+        return numReleased;
+    };
+}
+
+TEST_CASE ("Mapping expression performance")
+{
+    birdhouse::MappingExpression expression;
+    expression.set ("clamp (1 - x * 2 + 0.25) ^ 2");
+
+    BENCHMARK ("Evaluate an expression 1,000,000 times")
+    {
+        auto sum = 0.f;
+        for (auto i = 0; i < 1000000; ++i)
+        {
+            sum += expression.evaluate (static_cast<float> (i) * 1.0e-6f);
+        }
+        return sum;
+    };
+}
+
+TEST_CASE ("Scene morph performance")
+{
+    static constexpr int numMappings = 1000;
+
+    birdhouse::Scene from, to;
+    for (auto i = 0; i < numMappings; ++i)
+    {
+        from.channels.push_back ({ "/" + juce::String (i), 0.0f, 1.0f, 1, i % 128, birdhouse::MidiCC, false, 0.0f });
+        to.channels.push_back ({ "/" + juce::String (i), -1.0f, 2.0f, 1, i % 128, birdhouse::MidiCC, false, 1.0f });
+    }
+
+    birdhouse::SceneMorph<numMappings> morph;
+    morph.setScenes (&from, &to);
+    auto position = 0.f;
+
+    BENCHMARK ("Morph 1,000 mappings")
+    {
+        position = position > 0.5f ? 0.f : position + 0.01f;
+        morph.setPosition (position);
+
+        auto sum = 0.f;
+        morph.process ([&sum] (int, float value, float inMin, float inMax) { sum += juce::jmap (value, inMin, inMax, 0.0f, 1.0f); }, [] (int) {});
+        return sum;
+    };
+}
@@ -0,0 +1,278 @@
+#include "bridge/DirectMidiOutput.h"
+#include "bridge/OSCBridgeManager.h"
+#include "bridge/OSCInMemoryTransport.h"
+#include "bridge/OSCJuceUDPReceiver.h"
+#include "bridge/OSCPacketParser.h"
+#include "bridge/OSCSharedMemoryReceiver.h"
+#include "bridge/OSCUnixSocketReceiver.h"
+#include "catch2/benchmark/catch_benchmark_all.hpp"
+#include "catch2/catch_test_macros.hpp"
+#include "helpers/benchmark_helpers.h"
+
+// The bridge's dispatch path fed from memory: parsing, path matching and MIDI conversion without any sockets.
+// Deterministic, so the numbers can be compared between runs and machines.
+TEST_CASE ("Dispatch throughput")
+{
+    std::vector<std::shared_ptr<birdhouse::OSCBridgeChannel>> channels;
+    for (auto i = 0; i < 8; ++i)
+    {
+        channels.push_back (std::make_shared<birdhouse::OSCBridgeChannel> ("/" + juce::String (i + 1) + "/value", 0.0f, 1.0f, 1, 48 + i, birdhouse::MidiCC));
+    }
+
+    birdhouse::OSCBridgeManager manager (channels);
+    auto& transport = manager.addTransport<birdhouse::OSCInMemoryTransport>();
+    REQUIRE (manager.startListening (0));
+
+    const auto packet = makeOSCFloatPacket ("/8/value", 0.5f);
+    juce::MidiBuffer midi;
+
+    BENCHMARK ("In-memory inject and dispatch to the last of 8 channels")
+    {
+        transport.inject (packet);
+        channels.back()->appendMessagesTo (midi);
+        midi.clear();
+    };
+
+    // Paced playback from the transport's own thread, the way a sender streaming at a fixed rate would look
+    transport.resetNumPacketsInjected();
+    REQUIRE (transport.startPlayback ({ packet }, 10000.0));
+    juce::Thread::sleep (100);
+    transport.stopPlayback();
+    CHECK (transport.getNumPacketsInjected() > 500);
+
+    manager.stopListening();
+}
+
+#if BIRDHOUSE_HAS_UNIX_SOCKETS
+    #include <arpa/inet.h>
+    #include <netinet/in.h>
+
+// Each benchmark sends one packet and receives it again on the same thread, so the timings are the CPU cost of one
+// message through the kernel plus the bridge's parsing, without any thread wake up latency mixed in.
+TEST_CASE ("Transport performance")
+{
+    const auto packet = makeOSCFloatPacket ("/1/value", 0.5f);
+    std::array<char, 1024> receiveBuffer {};
+    auto numMessages = 0;
+    auto countMessage = [&numMessages] (const juce::OSCMessage&) { numMessages++; };
+
+    // UDP over the loopback interface
+    sockaddr_in udpAddress {};
+    udpAddress.sin_family = AF_INET;
+    udpAddress.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    socklen_t udpAddressLength = sizeof (udpAddress);
+
+    const auto udpReceiver = ::socket (AF_INET, SOCK_DGRAM, 0);
+    REQUIRE (::bind (udpReceiver, reinterpret_cast<const sockaddr*> (&udpAddress), sizeof (udpAddress)) == 0);
+    REQUIRE (::getsockname (udpReceiver, reinterpret_cast<sockaddr*> (&udpAddress), &udpAddressLength) == 0);
+
+    const auto udpSender = ::socket (AF_INET, SOCK_DGRAM, 0);
+    REQUIRE (::connect (udpSender, reinterpret_cast<const sockaddr*> (&udpAddress), sizeof (udpAddress)) == 0);
+
+    // Unix domain datagram socket
+    const auto unixPath = juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("birdhouse-benchmark.osc").getFullPathName();
+    sockaddr_un unixAddress {};
+    unixAddress.sun_family = AF_UNIX;
+    std::strncpy (unixAddress.sun_path, unixPath.toRawUTF8(), sizeof (unixAddress.sun_path) - 1);
+    ::unlink (unixAddress.sun_path);
+
+    const auto unixReceiver = ::socket (AF_UNIX, SOCK_DGRAM, 0);
+    REQUIRE (::bind (unixReceiver, reinterpret_cast<const sockaddr*> (&unixAddress), sizeof (unixAddress)) == 0);
+
+    const auto unixSender = ::socket (AF_UNIX, SOCK_DGRAM, 0);
+    REQUIRE (::connect (unixSender, reinterpret_cast<const sockaddr*> (&unixAddress), sizeof (unixAddress)) == 0);
+
+    BENCHMARK ("UDP loopback send, receive and parse")
+    {
+        ::send (udpSender, packet.data(), packet.size(), 0);
+        const auto numRead = ::recv (udpReceiver, receiveBuffer.data(), receiveBuffer.size(), 0);
+        return birdhouse::OSCPacketParser::parse (receiveBuffer.data(), static_cast<std::size_t> (numRead), countMessage);
+    };
+
+    BENCHMARK ("Unix datagram send, receive and parse")
+    {
+        ::send (unixSender, packet.data(), packet.size(), 0);
+        const auto numRead = ::recv (unixReceiver, receiveBuffer.data(), receiveBuffer.size(), 0);
+        return birdhouse::OSCPacketParser::parse (receiveBuffer.data(), static_cast<std::size_t> (numRead), countMessage);
+    };
+
+    CHECK (numMessages > 0);
+
+    ::close (udpSender);
+    ::close (udpReceiver);
+    ::close (unixSender);
+    ::close (unixReceiver);
+    ::unlink (unixAddress.sun_path);
+}
+
+// One way latency from handing a packet to the transport until the bridge's callback has seen it.
+// The receivers run on their own threads, exactly like in the plugin.
+TEST_CASE ("Transport latency")
+{
+    const auto port = 9876;
+    const auto packet = makeOSCFloatPacket ("/1/value", 0.5f);
+    std::atomic<int> numReceived { 0 };
+
+    auto waitForMessage = [&numReceived] (int numBefore) {
+        while (numReceived.load (std::memory_order_acquire) == numBefore)
+        {
+        }
+    };
+
+    auto countMessage = [&numReceived] (const juce::OSCMessage&) { numReceived.fetch_add (1, std::memory_order_release); };
+
+    sockaddr_in udpAddress {};
+    udpAddress.sin_family = AF_INET;
+    udpAddress.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    udpAddress.sin_port = htons (port);
+
+    const auto udpSender = ::socket (AF_INET, SOCK_DGRAM, 0);
+    REQUIRE (::connect (udpSender, reinterpret_cast<const sockaddr*> (&udpAddress), sizeof (udpAddress)) == 0);
+
+    // juce::OSCReceiver with a realtime callback, how the bridge used to receive UDP
+    {
+        birdhouse::OSCJuceUDPReceiver udpReceiver { countMessage };
+        REQUIRE (udpReceiver.connect (port));
+
+        BENCHMARK ("JUCE UDP loopback latency")
+        {
+            const auto numBefore = numReceived.load();
+            ::send (udpSender, packet.data(), packet.size(), 0);
+            waitForMessage (numBefore);
+        };
+    }
+
+    // The bridge's own UDP thread
+    {
+        birdhouse::OSCUDPReceiver udpReceiver { countMessage };
+        REQUIRE (udpReceiver.connect (port));
+
+        BENCHMARK ("UDP loopback latency")
+        {
+            const auto numBefore = numReceived.load();
+            ::send (udpSender, packet.data(), packet.size(), 0);
+            waitForMessage (numBefore);
+        };
+    }
+
+    ::close (udpSender);
+
+    // The shared memory ring
+    birdhouse::OSCSharedMemoryReceiver ringReceiver { countMessage };
+    REQUIRE (ringReceiver.connect (port));
+
+    auto* ring = birdhouse_ring_attach (port);
+    REQUIRE (ring != nullptr);
+
+    BENCHMARK ("Shared memory ring latency")
+    {
+        const auto numBefore = numReceived.load();
+        birdhouse_ring_write (ring, packet.data(), static_cast<std::uint32_t> (packet.size()));
+        waitForMessage (numBefore);
+    };
+
+    birdhouse_ring_detach (ring);
+    ringReceiver.disconnect();
+}
+#endif
+
+#if BIRDHOUSE_HAS_UNIX_SOCKETS && BIRDHOUSE_HAS_VIRTUAL_MIDI_PORTS
+    #include <thread>
+
+// From the UDP packet to MIDI leaving the bridge. Through processBlock the event waits for the next audio block,
+// simulated here at 512 samples and 48 kHz; the direct output sends it from the receive thread. The direct numbers
+// include the loop back through the ALSA sequencer (or CoreMIDI) to an input port, which needs no MIDI hardware.
+TEST_CASE ("MIDI output latency")
+{
+    const auto port = 9877;
+    const auto packet = makeOSCFloatPacket ("/1/value", 0.5f);
+    std::atomic<int> numReceived { 0 };
+
+    auto waitForMidi = [&numReceived] (int numBefore) {
+        while (numReceived.load (std::memory_order_acquire) == numBefore)
+        {
+        }
+    };
+
+    std::vector<std::shared_ptr<birdhouse::OSCBridgeChannel>> channels { std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 1, birdhouse::MidiCC) };
+    birdhouse::OSCBridgeManager manager (channels);
+    manager.addTransport<birdhouse::OSCUDPReceiver>();
+    REQUIRE (manager.startListening (port));
+
+    sockaddr_in udpAddress {};
+    udpAddress.sin_family = AF_INET;
+    udpAddress.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    udpAddress.sin_port = htons (port);
+
+    const auto udpSender = ::socket (AF_INET, SOCK_DGRAM, 0);
+    REQUIRE (::connect (udpSender, reinterpret_cast<const sockaddr*> (&udpAddress), sizeof (udpAddress)) == 0);
+
+    {
+        std::atomic<bool> audioThreadShouldExit { false };
+        std::thread audioThread ([&] {
+            juce::MidiBuffer midi;
+            const auto blockDuration = std::chrono::microseconds (512 * 1000000 / 48000);
+
+            while (!audioThreadShouldExit.load())
+            {
+                channels.front()->appendMessagesTo (midi);
+                numReceived.fetch_add (midi.getNumEvents(), std::memory_order_release);
+                midi.clear();
+                std::this_thread::sleep_for (blockDuration);
+            }
+        });
+
+        BENCHMARK ("UDP to MIDI through processBlock latency")
+        {
+            const auto numBefore = numReceived.load();
+            ::send (udpSender, packet.data(), packet.size(), 0);
+            waitForMidi (numBefore);
+        };
+
+        audioThreadShouldExit.store (true);
+        audioThread.join();
+    }
+
+    birdhouse::DirectMidiOutput output;
+
+    if (!output.open ("BirdHouse benchmark"))
+    {
+        WARN ("No virtual MIDI ports here (is the ALSA sequencer loaded?), skipping the direct output latency");
+        ::close (udpSender);
+        return;
+    }
+
+    struct CountingCallback : juce::MidiInputCallback
+    {
+        explicit CountingCallback (std::atomic<int>& counter) : count (counter) {}
+        void handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage&) override { count.fetch_add (1, std::memory_order_release); }
+        std::atomic<int>& count;
+    };
+
+    CountingCallback callback { numReceived };
+    std::unique_ptr<juce::MidiInput> input;
+
+    for (const auto& device : juce::MidiInput::getAvailableDevices())
+    {
+        if (device.name.contains ("BirdHouse benchmark"))
+        {
+            input = juce::MidiInput::openDevice (device.identifier, &callback);
+        }
+    }
+
+    REQUIRE (input != nullptr);
+    input->start();
+    manager.setDirectMidiOutput (&output);
+
+    BENCHMARK ("UDP to MIDI through the direct output latency")
+    {
+        const auto numBefore = numReceived.load();
+        ::send (udpSender, packet.data(), packet.size(), 0);
+        waitForMidi (numBefore);
+    };
+
+    manager.setDirectMidiOutput (nullptr);
+    input->stop();
+    ::close (udpSender);
+}
+#endif
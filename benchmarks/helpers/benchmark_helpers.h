@@ -0,0 +1,35 @@
+#pragma once
+#include <cstring>
+#include <juce_core/juce_core.h>
+#include <vector>
+
+/* Encodes an OSC message with a single float argument, the way most senders talk to BirdHouse.
+ *
+ * Example usage (a packet for the default path of channel 1)
+ *
+  auto packet = makeOSCFloatPacket ("/1/value", 0.5f);
+  ::send (socket, packet.data(), packet.size(), 0);
+
+ */
+[[maybe_unused]] static std::vector<char> makeOSCFloatPacket (const char* address, float value)
+{
+    std::vector<char> packet;
+
+    auto appendPaddedString = [&packet] (const char* string) {
+        const auto length = std::strlen (string);
+        packet.insert (packet.end(), string, string + length);
+        packet.resize (packet.size() + 4 - (length % 4), '\0');
+    };
+
+    appendPaddedString (address);
+    appendPaddedString (",f");
+
+    juce::uint32 bits;
+    std::memcpy (&bits, &value, sizeof (bits));
+    bits = juce::ByteOrder::swapIfLittleEndian (bits);
+
+    const auto* bytes = reinterpret_cast<const char*> (&bits);
+    packet.insert (packet.end(), bytes, bytes + sizeof (bits));
+
+    return packet;
+}
@@ -113,7 +113,7 @@ PluginEditor::PluginEditor (PluginProcessor& p)
 
     connectionStatusLabel.setFont (labelFont);
     connectionStatusLabel.setColour (juce::Label::textColourId, BirdHouse::Colours::fg);
-    connectionStatusLabel.setText (processorRef.isConnected() ? "Connected" : "Disconnected",
+    connectionStatusLabel.setText (processorRef.isConnected() ? "Connected" : processorRef.getConnectionStatus(),
         juce::dontSendNotification);
     connectionStatusLabel.setJustificationType (juce::Justification::centred);
 
@@ -149,8 +149,9 @@ void PluginEditor::paint (juce::Graphics& g)
     {
         // portEditor.applyColourToAllText (BirdHouse::Colours::red, true);
 
+        // Names the transports that failed, e.g. "UDP failed" when another program has the port
         connectionStatusLabel.setColour (juce::Label::textColourId, BirdHouse::Colours::red);
-        connectionStatusLabel.setText ("Disconnected", juce::dontSendNotification);
+        connectionStatusLabel.setText (processorRef.getConnectionStatus(), juce::dontSendNotification);
     }
 
     // Update the activity indicators
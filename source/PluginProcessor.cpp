@@ -37,6 +37,7 @@ PluginProcessor::PluginProcessor()
         // Set up the channel
         mOscBridgeChannels.push_back (std::make_shared<birdhouse::OSCBridgeChannel> (
             path, inMin, inMax, outChan, outNum, static_cast<birdhouse::MsgType> (static_cast<int> (msgType))));
+        mOscBridgeChannels[index]->setMPEVoicePool (mMPEVoicePool);
 
         DBG ("Initial state of channel " + juce::String (i) + " is :");
         DBG ("Path: " + path.toString());
@@ -49,16 +50,37 @@ PluginProcessor::PluginProcessor()
 
         // Set mute
         mOscBridgeChannels[index]->state().setMuted (muted);
+
+        mAutomationOutput.addParameter (parameters.getParameter ("Value" + juce::String (i + 1)));
     }
 
+    mScenes.attach (mOscBridgeChannels);
+
     // Register all channels with the OSCBridge manager
     mOscBridgeManager = std::make_shared<birdhouse::OSCBridgeManager> (mOscBridgeChannels);
+    mOscBridgeManager->addDefaultTransports();
+
+    // Switches scenes before the channels see the message, so they already use the new mapping for it
+    mOscBridgeManager->addGlobalCallback ([this] (const juce::OSCMessage& message) {
+        if (message.getAddressPattern().toString() == "/birdhouse/scene" && message.size() == 1 && (message[0].isInt32() || message[0].isFloat32()))
+        {
+            mScenes.select (message[0].isInt32() ? message[0].getInt32() : juce::roundToInt (message[0].getFloat32()));
+        }
+
+        if (message.getAddressPattern().toString() == "/birdhouse/morph" && message.size() == 1 && message[0].isFloat32())
+        {
+            mSceneMorph.setPosition (message[0].getFloat32());
+        }
+    });
 
     // Set up listeners for the state changes
     mGlobalStateListener = std::make_shared<LambdaStateListener> (parameters.state);
 
     setStateChangeCallbacks();
     updateListenerStates();
+    updateOSCSenderFromState();
+    updateDirectMidiOutputFromState();
+    updateScenesFromState();
 }
 
 PluginProcessor::~PluginProcessor()
@@ -137,7 +159,16 @@ void PluginProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
-    juce::ignoreUnused (sampleRate, samplesPerBlock);
+    mNoteOffScheduler.prepare (sampleRate);
+    mControlSignals.prepare (sampleRate, samplesPerBlock, numBridgeChans);
+    mAutomationOutput.prepare (sampleRate);
+    mRateLimiter.prepare (sampleRate);
+
+    for (auto& chan : mOscBridgeChannels)
+    {
+        chan->prepare (sampleRate);
+    }
+    mMidiThru.prepare (8192);
 
     // Set default values for each channel
     // if (!isConnected())
@@ -150,7 +181,13 @@ void PluginProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 
 void PluginProcessor::tryConnect (auto port)
 {
+    // The receive threads read their options when they start, so they only change while everything is stopped
     mOscBridgeManager->stopListening();
+    mOscBridgeManager->setReceiveThreadOptions (getReceiveThreadOptionsFromState());
+    updateTransportsFromState();
+
+    // Every transport derives its address from the port: UDP and TCP listen on it, the Unix socket and the shared
+    // memory ring are named after it
     auto connectionResult = mOscBridgeManager->startListening (static_cast<int> (port));
     DBG ("Connection result: " + juce::String (static_cast<int> (connectionResult)));
     if (static_cast<bool> (connectionResult))
@@ -165,6 +202,147 @@ void PluginProcessor::tryConnect (auto port)
     mConnected = static_cast<bool> (connectionResult);
 }
 
+juce::String PluginProcessor::getConnectionStatus() const
+{
+    const auto failed = mOscBridgeManager->getFailedTransports();
+    return failed.isEmpty() ? juce::String ("Connected") : failed.joinIntoString (", ") + " failed";
+}
+
+// UDP is always on. The other transports are stored in the state, off by default, and only change while stopped.
+void PluginProcessor::updateTransportsFromState()
+{
+    const auto& state = parameters.state;
+
+    // 0 off, 1 only this computer, 2 every network interface
+    const auto tcpMode = static_cast<int> (state.getProperty ("TCPReceive", 0));
+    if (auto* tcp = mOscBridgeManager->findTransport<birdhouse::OSCTCPReceiver>())
+    {
+        tcp->setEnabled (tcpMode > 0);
+        tcp->setLocalOnly (tcpMode != 2);
+    }
+
+    if (auto* unixSocket = mOscBridgeManager->findTransport<birdhouse::OSCUnixSocketReceiver>())
+    {
+        unixSocket->setEnabled (state.getProperty ("UnixSocketReceive", false));
+    }
+
+    if (auto* sharedMemory = mOscBridgeManager->findTransport<birdhouse::OSCSharedMemoryReceiver>())
+    {
+        sharedMemory->setEnabled (state.getProperty ("SharedMemoryReceive", false));
+    }
+}
+
+// Scheduling of the receive thread. These are not exposed to the host, they are stored in the state like the paths.
+birdhouse::ReceiveThreadOptions PluginProcessor::getReceiveThreadOptionsFromState() const
+{
+    const birdhouse::ReceiveThreadOptions defaults;
+
+    return birdhouse::ReceiveThreadOptions::fromSettings (
+        parameters.state.getProperty ("ReceiveThreadPolicy", static_cast<int> (defaults.policy)),
+        parameters.state.getProperty ("ReceiveThreadPriority", defaults.priority),
+        parameters.state.getProperty ("ReceiveThreadAffinity", 0));
+}
+
+// Also stored in the state, not exposed to the host
+void PluginProcessor::updateOSCSenderFromState()
+{
+    const auto& state = parameters.state;
+
+    if (!static_cast<bool> (state.getProperty ("OSCSend", false)))
+    {
+        mOscReverseBridge.stop();
+        return;
+    }
+
+    const auto host = state.getProperty ("OSCSendHost", "127.0.0.1").toString();
+    const auto port = static_cast<int> (state.getProperty ("OSCSendPort", 9000));
+    const auto intervalMs = static_cast<int> (state.getProperty ("OSCSendInterval", 20));
+    const auto maxMessagesPerSecond = static_cast<int> (state.getProperty ("OSCSendRate", 500));
+
+    if (!mOscReverseBridge.start (host, port, intervalMs, maxMessagesPerSecond))
+    {
+        juce::Logger::writeToLog ("Could not send OSC to " + host + ":" + juce::String (port));
+    }
+}
+
+// In the Standalone app MIDI only leaves through the audio callback, up to a block late. With DirectMidiOutput set, the
+// bridge writes to a virtual port (an ALSA sequencer port on Linux) as soon as the OSC arrives instead.
+void PluginProcessor::updateDirectMidiOutputFromState()
+{
+    const auto wanted = wrapperType == wrapperType_Standalone && static_cast<bool> (parameters.state.getProperty ("DirectMidiOutput", false));
+
+    if (wanted == mDirectMidiOutput.isOpen())
+    {
+        return;
+    }
+
+    // Stop the bridge sending to the port before closing it. Closing sends all notes off on the channels it played.
+    mOscBridgeManager->setDirectMidiOutput (nullptr);
+    mDirectMidiOutput.close();
+
+    if (wanted && mDirectMidiOutput.open (JucePlugin_Name))
+    {
+        mOscBridgeManager->setDirectMidiOutput (&mDirectMidiOutput);
+    }
+}
+
+void PluginProcessor::storeScene (int sceneNumber)
+{
+    if (sceneNumber < 1 || sceneNumber > birdhouse::SceneBank::numScenes)
+    {
+        return;
+    }
+
+    auto scene = birdhouse::SceneBank::capture (mOscBridgeChannels);
+
+    // Saved with the state, replacing an earlier version of the scene. The tree is complete before it is added, so
+    // the state listener doesn't see every property of it.
+    auto scenes = parameters.state.getOrCreateChildWithName ("Scenes", nullptr);
+    for (auto i = scenes.getNumChildren(); --i >= 0;)
+    {
+        if (static_cast<int> (scenes.getChild (i).getProperty ("Number", 0)) == sceneNumber)
+        {
+            scenes.removeChild (i, nullptr);
+        }
+    }
+    scenes.appendChild (birdhouse::SceneBank::toValueTree (scene, sceneNumber), nullptr);
+
+    mScenes.store (sceneNumber, std::move (scene));
+    updateMorphFromState();
+}
+
+// Loads every saved scene into memory once, so switching never touches the state. Scenes the state doesn't have are
+// removed, they belonged to the state before.
+void PluginProcessor::updateScenesFromState()
+{
+    const auto scenes = parameters.state.getChildWithName ("Scenes");
+
+    for (auto sceneNumber = 1; sceneNumber <= birdhouse::SceneBank::numScenes; ++sceneNumber)
+    {
+        const auto tree = scenes.getChildWithProperty ("Number", sceneNumber);
+
+        if (tree.isValid())
+        {
+            mScenes.store (sceneNumber, birdhouse::SceneBank::fromValueTree (tree, numBridgeChans));
+        }
+        else
+        {
+            mScenes.remove (sceneNumber);
+        }
+    }
+
+    mScenes.select (parameters.state.getProperty ("Scene", 0));
+    updateMorphFromState();
+}
+
+// Packs the two scenes again, after either of them was chosen or stored
+void PluginProcessor::updateMorphFromState()
+{
+    const auto& state = parameters.state;
+    mSceneMorph.setScenes (mScenes.getScene (state.getProperty ("MorphFrom", 0)), mScenes.getScene (state.getProperty ("MorphTo", 0)));
+    mSceneMorph.setPosition (state.getProperty ("Morph", 0.0f));
+}
+
 void PluginProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
@@ -178,10 +356,9 @@ bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
     juce::ignoreUnused (layouts);
     return true;
 #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-        && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Mono, stereo, or up to one control signal output per channel
+    const auto numOutputs = layouts.getMainOutputChannelSet().size();
+    if (numOutputs < 1 || numOutputs > numBridgeChans)
         return false;
 
         // This checks if the input layout matches the output layout
@@ -206,27 +383,139 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer,
         mParametersNeedUpdating = false;
     }
 
-    // Create temporary buffer for MIDI messages to allow double-buffering
-    juce::MidiBuffer tmpMidi;
+    // The MPE zones share the member channels between them when both are in use
+    auto lowerZoneInUse = false, upperZoneInUse = false;
+    for (const auto& chan : mOscBridgeChannels)
+    {
+        if (chan->state().outType() == birdhouse::MsgType::MidiMPE)
+        {
+            (chan->state().outChan() == 16 ? upperZoneInUse : lowerZoneInUse) = true;
+        }
+    }
+    mMPEVoicePool->setZonesInUse (lowerZoneInUse, upperZoneInUse);
 
-    for (auto sampleNum = 0; sampleNum < buffer.getNumSamples(); ++sampleNum)
+    // A program change on the scene channel switches scenes, program 0 being the channels' own settings
+    if (const auto sceneChannel = mSceneChannel.load(); sceneChannel > 0)
     {
-        // Check if any of the channels have had changes in midi, if so, append note off to all channels
-        // This is to prevent stuck notes
-        for (auto& chan : mOscBridgeChannels)
+        for (const auto metadata : midiMessages)
         {
-            if (chan->state().midiChanged())
+            if (metadata.numBytes == 2 && (metadata.data[0] & 0xf0) == 0xc0 && (metadata.data[0] & 0x0f) + 1 == sceneChannel)
             {
-                tmpMidi.addEvent (juce::MidiMessage::allNotesOff (chan->state().outChan()), sampleNum);
-                chan->state().resetMidiFlag();
+                mScenes.select (metadata.data[1]);
             }
+        }
+    }
+
+    // Every channel may have a new mapping after a scene switch, wherever it came from
+    const auto numSceneSwitches = mScenes.getNumSwitches();
+    const auto sceneChanged = numSceneSwitches != mLastNumSceneSwitches;
+    mLastNumSceneSwitches = numSceneSwitches;
+
+    // The channels' events are written straight into the host's buffer. The incoming MIDI is moved out of the way
+    // and merged back in at the end.
+    mOscReverseBridge.handleIncomingMidi (midiMessages);
+    mMidiThru.takeInput (midiMessages);
+    mRateLimiter.refill (buffer.getNumSamples());
+
+    // Note ons of channels with a note length get their note off scheduled. Every message written counts towards
+    // the output budget of the block.
+    auto numWritten = 0;
+    auto scheduleNoteOffsFor = [this, &numWritten] (int index) {
+        return [this, &numWritten, index, noteLength = mOscBridgeChannels[static_cast<std::size_t> (index)]->state().noteLength()] (const juce::uint8* bytes, int numBytes, int sampleOffset) {
+            ++numWritten;
+            mNoteOffScheduler.handleWrittenMessage (index, bytes, numBytes, sampleOffset, noteLength);
+        };
+    };
+
+    // Notes and program changes of all channels go first, however many controllers are queued
+    for (auto index = 0; index < numBridgeChans; ++index)
+    {
+        mOscBridgeChannels[static_cast<std::size_t> (index)]->appendPriorityMessagesTo (midiMessages, 0, scheduleNoteOffsFor (index));
+    }
+
+    // Only does anything in blocks where the morph moved. Its messages go through the rate limit like the others, and
+    // OSC arriving during the morph is scaled by the morphed ranges.
+    mSceneMorph.process (
+        [this, &midiMessages, &numWritten] (int index, float value, float inMin, float inMax) {
+            auto& chan = mOscBridgeChannels[static_cast<std::size_t> (index)];
+            chan->state().setMorphedRange (inMin, inMax);
+            chan->appendMorphTo (
+                midiMessages,
+                chan->state().normalizeValue (value, inMin, inMax),
+                [&numWritten] (const juce::uint8*, int, int) { ++numWritten; },
+                [this, index] (const juce::uint8* bytes, int numBytes) { return mRateLimiter.admit (index, bytes, numBytes); });
+        },
+        [this] (int index) { mOscBridgeChannels[static_cast<std::size_t> (index)]->state().clearMorphedRange(); });
+
+    const auto outputBudget = mOutputBudget.load();
+
+    for (auto index = 0; index < numBridgeChans; ++index)
+    {
+        auto& chan = mOscBridgeChannels[static_cast<std::size_t> (index)];
+        auto scheduleNoteOffs = scheduleNoteOffsFor (index);
+
+        // Controllers beyond the channel's or the output's rate wait for room, as the channel's latest value
+        auto admit = [this, index, limited = chan->isRateLimited()] (const juce::uint8* bytes, int numBytes) {
+            return !limited || mRateLimiter.admit (index, bytes, numBytes);
+        };
+
+        // Once the block's budget is used up, channels with one message per value only send their latest one
+        auto coalesce = [&numWritten, outputBudget, limited = chan->isRateLimited()] {
+            return limited && outputBudget > 0 && numWritten >= outputBudget;
+        };
+
+        chan->appendControllerMessagesTo (midiMessages, 0, scheduleNoteOffs, admit, coalesce);
+        chan->appendUMPAsMidi1To (midiMessages, 0, scheduleNoteOffs, admit);
+        chan->appendMPETo (midiMessages, 0, scheduleNoteOffs);
+        chan->appendGlideTo (midiMessages, buffer.getNumSamples(), mGlideDensity.load(), scheduleNoteOffs, admit);
+        mRateLimiter.flushPending (index, [&midiMessages, &numWritten] (const birdhouse::MidiEvent& event) {
+            midiMessages.addEvent (event.bytes.data(), event.numBytes, 0);
+            ++numWritten;
+        });
+
+        // If the channel's mapping changed, release the notes it left sounding to prevent stuck notes.
+        // This runs after appending, so notes queued under the old mapping are released too.
+        if (chan->state().consumeMidiChanged() || sceneChanged)
+        {
+            chan->releaseStaleNotes (midiMessages);
+        }
+    }
+
+    mNoteOffScheduler.advance (buffer.getNumSamples(), [this, &midiMessages] (int bridgeChannel, const birdhouse::MidiEvent& noteOff, int sampleOffset) {
+        auto& chan = mOscBridgeChannels[static_cast<std::size_t> (bridgeChannel)];
 
-            chan->appendMessagesTo (tmpMidi, sampleNum);
+        // Skip notes that have already been released some other way
+        if (chan->isNoteActive (noteOff.channel(), noteOff.data1()))
+        {
+            midiMessages.addEvent (noteOff.bytes.data(), noteOff.numBytes, sampleOffset);
+            chan->noteReleased (noteOff.channel(), noteOff.data1());
+        }
+    });
+
+    mMidiThru.mergeInto (midiMessages);
+
+    // Channel n goes to output n, when that output exists
+    const auto numControlSignals = juce::jmin (buffer.getNumChannels(), numBridgeChans);
+    for (auto index = 0; index < numControlSignals; ++index)
+    {
+        auto& chan = mOscBridgeChannels[static_cast<std::size_t> (index)];
+
+        if (chan->state().controlSignalOutput())
+        {
+            const auto value = juce::jlimit (0.0f, 1.0f, chan->getOutputValue());
+            mControlSignals.render (index, value, buffer.getWritePointer (index), buffer.getNumSamples());
         }
     }
 
-    // Replace the original midiMessages with the processed ones
-    midiMessages.swapWith (tmpMidi);
+    for (auto index = 0; index < numBridgeChans; ++index)
+    {
+        auto& chan = mOscBridgeChannels[static_cast<std::size_t> (index)];
+
+        if (chan->state().automationOutput())
+        {
+            mAutomationOutput.write (index, juce::jlimit (0.0f, 1.0f, chan->getOutputValue()), buffer.getNumSamples());
+        }
+    }
 }
 
 //==============================================================================
@@ -244,6 +533,9 @@ juce::AudioProcessorEditor* PluginProcessor::createEditor()
 void PluginProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
     auto state = parameters.copyState();
+
+    // Switching scenes doesn't go through the state, so the one playing is only written here
+    state.setProperty ("Scene", mScenes.getActiveSceneNumber(), nullptr);
     std::unique_ptr<juce::XmlElement> xml (state.createXml());
     DBG ("Getting state information from xml");
     copyXmlToBinary (*xml, destData);
@@ -261,6 +553,9 @@ void PluginProcessor::setStateInformation (const void* data, int sizeInBytes)
             parameters.state = juce::ValueTree::fromXml (*xmlState);
             updateListenerStates();
             updateValuesFromNonAudioParams (parameters.state);
+            updateOSCSenderFromState();
+            updateDirectMidiOutputFromState();
+            updateScenesFromState();
         }
     }
 }
@@ -287,6 +582,60 @@ void PluginProcessor::setStateChangeCallbacks()
         //     return;
         // }
 
+        if (whatChanged == juce::Identifier ("ReceiveThreadPolicy")
+            || whatChanged == juce::Identifier ("ReceiveThreadPriority")
+            || whatChanged == juce::Identifier ("ReceiveThreadAffinity")
+            || whatChanged == juce::Identifier ("TCPReceive")
+            || whatChanged == juce::Identifier ("UnixSocketReceive")
+            || whatChanged == juce::Identifier ("SharedMemoryReceive"))
+        {
+            // Restart the receive threads with the new scheduling and transports
+            tryConnect (static_cast<juce::AudioParameterInt*> (parameters.getParameter ("Port"))->get());
+            return;
+        }
+
+        if (whatChanged.toString().startsWith ("OSCSend"))
+        {
+            updateOSCSenderFromState();
+            return;
+        }
+
+        if (whatChanged == juce::Identifier ("DirectMidiOutput"))
+        {
+            updateDirectMidiOutputFromState();
+            return;
+        }
+
+        if (whatChanged == juce::Identifier ("Scene"))
+        {
+            mScenes.select (state.getProperty ("Scene", 0));
+            return;
+        }
+
+        // Stores the current mappings as the scene with this number, then goes back to 0 for the next one
+        if (whatChanged == juce::Identifier ("StoreScene"))
+        {
+            const auto sceneNumber = static_cast<int> (state.getProperty ("StoreScene", 0));
+            if (sceneNumber != 0)
+            {
+                storeScene (sceneNumber);
+                state.setProperty ("StoreScene", 0, nullptr);
+            }
+            return;
+        }
+
+        if (whatChanged == juce::Identifier ("MorphFrom") || whatChanged == juce::Identifier ("MorphTo"))
+        {
+            updateMorphFromState();
+            return;
+        }
+
+        if (whatChanged == juce::Identifier ("Morph"))
+        {
+            mSceneMorph.setPosition (state.getProperty ("Morph", 0.0f));
+            return;
+        }
+
         if (whatChanged == juce::Identifier ("ConnectionStatus"))
         {
             auto fallbackValue = false;
@@ -318,7 +667,56 @@ void PluginProcessor::updateValuesFromNonAudioParams (auto state)
         mOscBridgeChannels[chanNum - 1]->state().setPath (newPath);
         mOscBridgeChannels[chanNum - 1]->state().setInputMin (newInMin);
         mOscBridgeChannels[chanNum - 1]->state().setInputMax (newInMax);
+
+        const auto noteLengthIdentifier = juce::Identifier (juce::String ("NoteLength") + juce::String (chanNum));
+        mOscBridgeChannels[chanNum - 1]->state().setNoteLength (state.getProperty (noteLengthIdentifier, 0.0f));
+
+        const auto controlSignalIdentifier = juce::Identifier (juce::String ("CV") + juce::String (chanNum));
+        mOscBridgeChannels[chanNum - 1]->state().setControlSignalOutput (state.getProperty (controlSignalIdentifier, false));
+
+        const auto glideIdentifier = juce::Identifier (juce::String ("Glide") + juce::String (chanNum));
+        mOscBridgeChannels[chanNum - 1]->state().setGlideTime (state.getProperty (glideIdentifier, 0.0f));
+
+        const auto curveIdentifier = juce::Identifier (juce::String ("Curve") + juce::String (chanNum));
+        const auto curveAmountIdentifier = juce::Identifier (juce::String ("CurveAmount") + juce::String (chanNum));
+        const auto curvePointsIdentifier = juce::Identifier (juce::String ("CurvePoints") + juce::String (chanNum));
+        mOscBridgeChannels[chanNum - 1]->state().setResponseCurve (static_cast<birdhouse::CurveType> (juce::jlimit (0, birdhouse::NumCurveTypes - 1, static_cast<int> (state.getProperty (curveIdentifier, 0)))),
+            state.getProperty (curveAmountIdentifier, 4.0f),
+            state.getProperty (curvePointsIdentifier, "").toString());
+
+        const auto expressionIdentifier = juce::Identifier (juce::String ("Expression") + juce::String (chanNum));
+        mOscBridgeChannels[chanNum - 1]->state().setExpression (state.getProperty (expressionIdentifier, "").toString());
+
+        const auto smoothingIdentifier = juce::Identifier (juce::String ("Smoothing") + juce::String (chanNum));
+        const auto smoothingTimeIdentifier = juce::Identifier (juce::String ("SmoothingTime") + juce::String (chanNum));
+        mOscBridgeChannels[chanNum - 1]->state().setSmoothingMode (static_cast<birdhouse::SmoothingMode> (juce::jlimit (0, birdhouse::NumSmoothingModes - 1, static_cast<int> (state.getProperty (smoothingIdentifier, 0)))));
+        mOscBridgeChannels[chanNum - 1]->state().setSmoothingTime (state.getProperty (smoothingTimeIdentifier, 50.0f));
+
+        const auto rateLimitIdentifier = juce::Identifier (juce::String ("RateLimit") + juce::String (chanNum));
+        mRateLimiter.setChannelRate (static_cast<int> (chanNum - 1), state.getProperty (rateLimitIdentifier, 0.0f));
+
+        const auto automationIdentifier = juce::Identifier (juce::String ("Automation") + juce::String (chanNum));
+        mOscBridgeChannels[chanNum - 1]->state().setAutomationOutput (state.getProperty (automationIdentifier, false));
     }
+
+    // 0 is MIDI 1.0, 1 is MIDI 2.0 (UMP, downconverted for the host)
+    const auto useMidi2 = static_cast<int> (state.getProperty ("OutputProtocol", 0)) == 1;
+    for (auto& chan : mOscBridgeChannels)
+    {
+        chan->state().setMidi2Output (useMidi2);
+    }
+
+    mControlSignals.setSmoothingTime (state.getProperty ("CVSmoothing", 10.0f));
+    mAutomationOutput.setMinimumInterval (state.getProperty ("AutomationInterval", 20.0f));
+    mGlideDensity.store (state.getProperty ("GlideDensity", 1000.0f));
+    mRateLimiter.setOutputRate (state.getProperty ("RateLimit", 0.0f));
+    mOutputBudget.store (juce::jmax (0, static_cast<int> (state.getProperty ("OutputBudget", 0))));
+    mSceneChannel.store (juce::jlimit (0, 16, static_cast<int> (state.getProperty ("SceneChannel", 0))));
+
+    // Incoming MIDI passthrough, on by default for every channel and type
+    mMidiThru.setEnabled (static_cast<bool> (state.getProperty ("MidiThru", true)));
+    mMidiThru.setChannelMask (static_cast<juce::uint16> (static_cast<int> (state.getProperty ("MidiThruChannels", birdhouse::MidiThru::allChannels))));
+    mMidiThru.setTypeMask (static_cast<int> (state.getProperty ("MidiThruTypes", birdhouse::ThruAllTypes)));
 }
 
 // Update internal state from audio parameters.
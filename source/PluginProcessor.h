@@ -1,8 +1,17 @@
 #pragma once
 
+#include "bridge/ControlSignalOutput.h"
+#include "bridge/DirectMidiOutput.h"
+#include "bridge/HostParameterOutput.h"
 #include "bridge/LambdaStateListener.h"
+#include "bridge/MidiRateLimiter.h"
+#include "bridge/MidiThru.h"
+#include "bridge/NoteOffScheduler.h"
 #include "bridge/OSCBridgeChannel.h"
 #include "bridge/OSCBridgeManager.h"
+#include "bridge/OSCReverseBridge.h"
+#include "bridge/SceneBank.h"
+#include "bridge/SceneMorph.h"
 #include "dsp/BirdHouseParams.h"
 #include "dsp/SimpleNoiseGenerator.h"
 #include <juce_audio_processors/juce_audio_processors.h>
@@ -56,6 +65,32 @@ public:
         return mConnected.load();
     }
 
+    // "Connected", or which of the enabled transports couldn't start listening
+    juce::String getConnectionStatus() const;
+
+    // Receive thread scheduling
+    birdhouse::ReceiveThreadOptions getReceiveThreadOptionsFromState() const;
+    void updateTransportsFromState();
+    auto isReceiveThreadRealtime() const { return mOscBridgeManager->isReceiveThreadRealtime(); }
+    auto getReceiveLatencyStats() const { return mOscBridgeManager->getReceiveLatencyStats(); }
+
+    // Controller messages of a channel held back by its rate limit or the output's, since the plugin was created
+    auto getNumRateLimited (int channel) const { return mRateLimiter.getNumLimited (channel); }
+
+    // Sending incoming MIDI back out as OSC
+    void updateOSCSenderFromState();
+
+    // Standalone only: MIDI straight to a virtual port instead of through processBlock
+    void updateDirectMidiOutputFromState();
+
+    // Scenes: snapshots of all channels' mappings, switched by OSC or program change (see SceneBank)
+    void storeScene (int sceneNumber);
+    void updateScenesFromState();
+    auto getActiveSceneNumber() const { return mScenes.getActiveSceneNumber(); }
+
+    // Morphing between two stored scenes (see SceneMorph)
+    void updateMorphFromState();
+
     // State
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
@@ -71,10 +106,49 @@ public:
 
 private:
     std::atomic<bool> mConnected = false;
+
+    // Declared before the bridge, which may still be sending to it until its transports are stopped
+    birdhouse::DirectMidiOutput mDirectMidiOutput;
+
+    // Declared before the channels, which read their mapping from the active scene
+    birdhouse::SceneBank mScenes;
+
+    // Member channels of the MPE zones, shared by all MPE channels
+    std::shared_ptr<birdhouse::MPEVoicePool> mMPEVoicePool { std::make_shared<birdhouse::MPEVoicePool>() };
+
     std::vector<std::shared_ptr<birdhouse::OSCBridgeChannel>> mOscBridgeChannels;
     std::shared_ptr<birdhouse::OSCBridgeManager> mOscBridgeManager;
+    birdhouse::OSCReverseBridge mOscReverseBridge { mOscBridgeChannels };
 
     std::shared_ptr<LambdaStateListener> mGlobalStateListener;
 
+    // Pending note offs of channels with a note length, audio thread only
+    birdhouse::NoteOffScheduler mNoteOffScheduler;
+
+    // Incoming MIDI, merged back into the output at the end of processBlock
+    birdhouse::MidiThru mMidiThru;
+
+    // Channel values as control signals on the audio outputs, if the build has any
+    birdhouse::ControlSignalOutput mControlSignals;
+
+    // Channel values written to the Value parameters
+    birdhouse::HostParameterOutput mAutomationOutput;
+
+    // Most steps per second of a CC or Bend glide
+    std::atomic<float> mGlideDensity { 1000.0f };
+
+    // Messages per second of each channel's controllers and of the output as a whole
+    birdhouse::MidiRateLimiter<numBridgeChans> mRateLimiter;
+
+    // Messages per block after which controllers are coalesced to their latest value, 0 is unlimited
+    std::atomic<int> mOutputBudget { 0 };
+
+    // MIDI channel whose program changes switch scenes, 0 is none. The switches seen are audio thread only.
+    std::atomic<int> mSceneChannel { 0 };
+    int mLastNumSceneSwitches { 0 };
+
+    // Crossfades the channels' values and ranges between the scenes MorphFrom and MorphTo
+    birdhouse::SceneMorph<numBridgeChans> mSceneMorph;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginProcessor)
 };
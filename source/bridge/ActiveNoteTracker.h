@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <juce_core/juce_core.h>
+
+namespace birdhouse
+{
+    /**
+     * @class ActiveNoteTracker
+     * @brief Bitmap of the notes that are currently sounding, 128 bits per MIDI channel
+     *
+     * Fed with the MIDI bytes that actually went to the host, so it knows exactly which notes need a note off when a
+     * mapping changes. midiChannel is 1 - 16 like everywhere else in the bridge. Audio thread only.
+     */
+    class ActiveNoteTracker
+    {
+    public:
+        void handleMessage (const juce::uint8* bytes, int numBytes)
+        {
+            if (numBytes < 3)
+            {
+                return;
+            }
+
+            const auto type = bytes[0] & 0xf0;
+            const auto midiChannel = (bytes[0] & 0x0f) + 1;
+
+            if (type == 0x90 && bytes[2] > 0)
+            {
+                noteOn (midiChannel, bytes[1]);
+            }
+            else if (type == 0x80 || type == 0x90)
+            {
+                noteOff (midiChannel, bytes[1]);
+            }
+        }
+
+        void noteOn (int midiChannel, int note)
+        {
+            word (midiChannel, note) |= bit (note);
+        }
+
+        void noteOff (int midiChannel, int note)
+        {
+            word (midiChannel, note) &= ~bit (note);
+        }
+
+        bool isActive (int midiChannel, int note) const
+        {
+            return (mNotes[channelIndex (midiChannel)][wordIndex (note)] & bit (note)) != 0;
+        }
+
+        bool isEmpty() const
+        {
+            for (auto& channel : mNotes)
+            {
+                if ((channel[0] | channel[1]) != 0)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Calls onNote (midiChannel, note) for every sounding note, skipping empty words
+        template <typename NoteCallback>
+        void forEachActiveNote (NoteCallback&& onNote) const
+        {
+            for (std::size_t channel = 0; channel < mNotes.size(); ++channel)
+            {
+                for (std::size_t index = 0; index < 2; ++index)
+                {
+                    for (auto bits = mNotes[channel][index]; bits != 0; bits &= bits - 1)
+                    {
+                        onNote (static_cast<int> (channel) + 1, static_cast<int> (index * 64) + std::countr_zero (bits));
+                    }
+                }
+            }
+        }
+
+        void clear()
+        {
+            for (auto& channel : mNotes)
+            {
+                channel.fill (0);
+            }
+        }
+
+    private:
+        static std::size_t channelIndex (int midiChannel) { return static_cast<std::size_t> ((midiChannel - 1) & 0x0f); }
+        static std::size_t wordIndex (int note) { return static_cast<std::size_t> ((note >> 6) & 1); }
+        static juce::uint64 bit (int note) { return juce::uint64 { 1 } << (note & 63); }
+
+        juce::uint64& word (int midiChannel, int note) { return mNotes[channelIndex (midiChannel)][wordIndex (note)]; }
+
+        std::array<std::array<juce::uint64, 2>, 16> mNotes {};
+    };
+}
@@ -0,0 +1,167 @@
+/*
+ * BirdHouse shared memory ring
+ *
+ * A single producer, single consumer byte ring in POSIX shared memory that local programs can use to hand OSC
+ * packets to BirdHouse without a system call per message. BirdHouse creates the ring (named after its port, see
+ * birdhouse_ring_name) and polls it, sleeping on a futex when it is idle. Producers only make a system call to wake
+ * it up when it is actually sleeping.
+ *
+ * This header is plain C99 so it can be dropped into any sender. It needs GCC or Clang (for the __atomic builtins)
+ * and a POSIX system. Link with -lrt on older glibc. On Linux, syscall() has to be visible, so either use the
+ * compiler's default GNU dialect or define _GNU_SOURCE when compiling with a strict -std=c99.
+ *
+ * Example usage:
+ *
+    birdhouse_ring* ring = birdhouse_ring_attach (8000);
+    if (ring)
+    {
+        birdhouse_ring_write (ring, packet, packetSize); // packet is an encoded OSC message or bundle
+        birdhouse_ring_detach (ring);
+    }
+ *
+ * Only one producer may write to a ring at a time.
+ */
+
+#ifndef BIRDHOUSE_SHARED_RING_H
+#define BIRDHOUSE_SHARED_RING_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+#endif
+
+#define BIRDHOUSE_RING_MAGIC 0x42495244u /* "BIRD" */
+#define BIRDHOUSE_RING_VERSION 1u
+#define BIRDHOUSE_RING_CAPACITY (1u << 20)
+#define BIRDHOUSE_RING_WRAP 0xFFFFFFFFu
+
+/* The layout is shared between processes, keep it stable and bump BIRDHOUSE_RING_VERSION when changing it */
+typedef struct birdhouse_ring
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity; /* Size of data in bytes, a power of two */
+    uint32_t consumer_pid; /* Process of the BirdHouse instance that created the ring, to tell a live ring from a stale one */
+    uint32_t padding0[12];
+
+    /* Written by the producer only, each on its own cache line */
+    uint64_t write_pos;
+    uint32_t signal; /* Futex word, incremented after every write */
+    uint32_t padding1[13];
+
+    /* Written by the consumer only */
+    uint64_t read_pos;
+    uint32_t consumer_waiting;
+    uint32_t padding2[13];
+
+    uint8_t data[BIRDHOUSE_RING_CAPACITY];
+} birdhouse_ring;
+
+static inline void birdhouse_ring_name (char* dest, size_t destSize, int port)
+{
+    snprintf (dest, destSize, "/birdhouse-%d", port);
+}
+
+/* Maps the ring created by the BirdHouse instance listening on port. Returns NULL if there is none. */
+static inline birdhouse_ring* birdhouse_ring_attach (int port)
+{
+    char name[64];
+    int fd;
+    void* memory;
+    birdhouse_ring* ring;
+
+    birdhouse_ring_name (name, sizeof (name), port);
+
+    fd = shm_open (name, O_RDWR, 0);
+    if (fd < 0)
+        return NULL;
+
+    memory = mmap (NULL, sizeof (birdhouse_ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+
+    if (memory == MAP_FAILED)
+        return NULL;
+
+    ring = (birdhouse_ring*) memory;
+    if (ring->magic != BIRDHOUSE_RING_MAGIC || ring->version != BIRDHOUSE_RING_VERSION)
+    {
+        munmap (memory, sizeof (birdhouse_ring));
+        return NULL;
+    }
+
+    return ring;
+}
+
+static inline void birdhouse_ring_detach (birdhouse_ring* ring)
+{
+    munmap (ring, sizeof (birdhouse_ring));
+}
+
+static inline void birdhouse_ring_wake_consumer (birdhouse_ring* ring)
+{
+    __atomic_fetch_add (&ring->signal, 1u, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n (&ring->consumer_waiting, __ATOMIC_SEQ_CST) != 0)
+    {
+#if defined(__linux__)
+        syscall (SYS_futex, &ring->signal, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+    }
+}
+
+/*
+ * Writes one packet. Each record is a 32 bit length followed by the packet, padded to 4 bytes.
+ * Returns 0 if the ring is full (the packet is dropped, nothing is written), 1 on success and -1 if the packet is
+ * larger than half the ring and can never be written.
+ */
+static inline int birdhouse_ring_write (birdhouse_ring* ring, const void* packet, uint32_t size)
+{
+    const uint64_t capacity = ring->capacity;
+    uint64_t recordSize;
+    uint64_t readPos;
+    uint64_t writePos;
+    uint64_t offset;
+    uint64_t needed;
+
+    /* Checked before any arithmetic on size, which would wrap for sizes close to 4 GiB */
+    if (capacity < 8u || size > capacity / 2u - 4u)
+        return -1;
+
+    recordSize = 4u + (((uint64_t) size + 3u) & ~(uint64_t) 3u);
+    readPos = __atomic_load_n (&ring->read_pos, __ATOMIC_ACQUIRE);
+    writePos = ring->write_pos;
+    offset = writePos & (capacity - 1u);
+    needed = recordSize;
+
+    /* Records never wrap around the end, skip to the start with a marker instead */
+    if (offset + recordSize > capacity)
+        needed += capacity - offset;
+
+    if (writePos + needed - readPos > capacity)
+        return 0;
+
+    if (offset + recordSize > capacity)
+    {
+        const uint32_t wrap = BIRDHOUSE_RING_WRAP;
+        memcpy (ring->data + offset, &wrap, sizeof (wrap));
+        writePos += capacity - offset;
+        offset = 0;
+    }
+
+    memcpy (ring->data + offset, &size, sizeof (size));
+    memcpy (ring->data + offset + 4u, packet, size);
+    writePos += recordSize;
+
+    __atomic_store_n (&ring->write_pos, writePos, __ATOMIC_SEQ_CST);
+    birdhouse_ring_wake_consumer (ring);
+    return 1;
+}
+
+#endif
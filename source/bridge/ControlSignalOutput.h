@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <vector>
+
+namespace birdhouse
+{
+    /**
+     * @class ControlSignalOutput
+     * @brief Renders channel values as smoothed control signals (CV) on audio outputs
+     *
+     * Each channel is read once per block and glides linearly to its latest value over the smoothing time. However
+     * many OSC messages arrived, a block costs one vectorized ramp and one fill per channel: the ramp is a scaled copy
+     * of a precomputed 1, 2, 3, ... table plus an offset. Audio thread only, apart from setSmoothingTime.
+     */
+    class ControlSignalOutput
+    {
+    public:
+        // Message thread, before playback
+        void prepare (double sampleRate, int maxBlockSize, int numChannels)
+        {
+            mSampleRate = sampleRate;
+            mRampTable.resize (static_cast<std::size_t> (juce::jmax (1, maxBlockSize)));
+
+            for (std::size_t i = 0; i < mRampTable.size(); ++i)
+            {
+                mRampTable[i] = static_cast<float> (i + 1);
+            }
+
+            mRamps.assign (static_cast<std::size_t> (numChannels), {});
+        }
+
+        void setSmoothingTime (float newSmoothingMs) { mSmoothingMs.store (juce::jmax (0.f, newSmoothingMs)); }
+
+        // Writes numSamples of the channel's signal, gliding towards target
+        void render (int channel, float target, float* destination, int numSamples)
+        {
+            auto& ramp = mRamps[static_cast<std::size_t> (channel)];
+
+            if (!ramp.initialised)
+            {
+                ramp = { target, target, 0.f, 0, true };
+            }
+            else if (target != ramp.target)
+            {
+                ramp.target = target;
+                ramp.remaining = juce::jmax (1, juce::roundToInt (mSmoothingMs.load() * 0.001 * mSampleRate));
+                ramp.step = (target - ramp.current) / static_cast<float> (ramp.remaining);
+            }
+
+            const auto maxChunk = static_cast<int> (mRampTable.size());
+
+            while (numSamples > 0)
+            {
+                const auto rampLength = juce::jmin (ramp.remaining, numSamples, maxChunk);
+
+                if (rampLength > 0)
+                {
+                    juce::FloatVectorOperations::copyWithMultiply (destination, mRampTable.data(), ramp.step, rampLength);
+                    juce::FloatVectorOperations::add (destination, ramp.current, rampLength);
+
+                    ramp.remaining -= rampLength;
+                    ramp.current = ramp.remaining == 0 ? ramp.target : destination[rampLength - 1];
+                    destination += rampLength;
+                    numSamples -= rampLength;
+                }
+                else
+                {
+                    juce::FloatVectorOperations::fill (destination, ramp.current, numSamples);
+                    numSamples = 0;
+                }
+            }
+        }
+
+    private:
+        struct Ramp
+        {
+            float current { 0.f }, target { 0.f }, step { 0.f };
+            int remaining { 0 };
+            bool initialised { false };
+        };
+
+        std::vector<float> mRampTable;
+        std::vector<Ramp> mRamps;
+        double mSampleRate { 44100.0 };
+        std::atomic<float> mSmoothingMs { 10.f };
+    };
+}
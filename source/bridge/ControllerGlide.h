@@ -0,0 +1,99 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+namespace birdhouse
+{
+    /**
+     * @class ControllerGlide
+     * @brief Spreads a jump of a controller value over a glide time, as evenly spaced steps within each block
+     *
+     * Instead of one jump at sample 0, the value moves linearly to its new target, with a step every spacing samples
+     * for as long as the glide lasts. The spacing comes from a maximum number of events per second, so the cost and
+     * the MIDI traffic per block are bounded however short the glide. Steps that round to the value already sent are
+     * skipped. Audio thread only.
+     */
+    class ControllerGlide
+    {
+    public:
+        void prepare (double sampleRate)
+        {
+            mSampleRate = sampleRate;
+            reset();
+        }
+
+        // Forget the current value, the next one is taken as is
+        void reset()
+        {
+            mInitialised = false;
+            mRemaining = 0;
+            mSamplesToNextStep = 0;
+        }
+
+        // Calls emit (float normalizedValue, int sampleOffset) for every step in this block.
+        // resolution is the largest value of the output, 127 for control change or 16383 for pitch bend.
+        template <typename EmitCallback>
+        void process (float target, float glideMs, float maxEventsPerSecond, int resolution, int numSamples, EmitCallback&& emit)
+        {
+            // Starts out at the current value without sending it, there's nothing to glide from yet
+            if (!mInitialised)
+            {
+                mInitialised = true;
+                mTarget = mCurrent = target;
+                mLastSent = toStep (target, resolution);
+                return;
+            }
+
+            if (target != mTarget)
+            {
+                mTarget = target;
+                mRemaining = juce::jmax (1, juce::roundToInt (glideMs * 0.001 * mSampleRate));
+                mStep = (target - mCurrent) / static_cast<float> (mRemaining);
+            }
+
+            const auto spacing = juce::jmax (1, juce::roundToInt (mSampleRate / juce::jmax (1.0f, maxEventsPerSecond)));
+            auto position = 0;
+
+            while (mRemaining > 0 && position < numSamples)
+            {
+                // The spacing carries over into the next block
+                const auto advance = juce::jmin (juce::jmin (spacing, mSamplesToNextStep), mRemaining, numSamples - position);
+
+                mRemaining -= advance;
+                mSamplesToNextStep -= advance;
+                mCurrent = mRemaining == 0 ? mTarget : mCurrent + mStep * static_cast<float> (advance);
+                position += advance;
+
+                if (mSamplesToNextStep > 0 && mRemaining > 0)
+                {
+                    continue;
+                }
+
+                mSamplesToNextStep = spacing;
+
+                const auto step = toStep (mCurrent, resolution);
+                if (step != mLastSent)
+                {
+                    mLastSent = step;
+                    emit (mCurrent, position - 1);
+                }
+            }
+        }
+
+        auto isGliding() const { return mRemaining > 0; }
+
+    private:
+        // Truncates like MidiMessageConverter, so a new step is always a new MIDI value
+        static int toStep (float normalizedValue, int resolution)
+        {
+            return static_cast<int> (juce::jlimit (0.0f, 1.0f, normalizedValue) * static_cast<float> (resolution));
+        }
+
+        double mSampleRate { 44100.0 };
+        float mCurrent { 0.f }, mTarget { 0.f }, mStep { 0.f };
+        int mRemaining { 0 };
+        int mSamplesToNextStep { 0 };
+        int mLastSent { -1 };
+        bool mInitialised { false };
+    };
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "MidiEvent.h"
+#include <atomic>
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <juce_core/juce_core.h>
+
+#if JUCE_LINUX || JUCE_MAC
+    #define BIRDHOUSE_HAS_VIRTUAL_MIDI_PORTS 1
+#else
+    #define BIRDHOUSE_HAS_VIRTUAL_MIDI_PORTS 0
+#endif
+
+namespace birdhouse
+{
+    /**
+     * @class DirectMidiOutput
+     * @brief A virtual MIDI output port the bridge can write to straight from the OSC dispatch
+     *
+     * On Linux this is an ALSA sequencer port, on macOS a CoreMIDI source. Events are sent the moment they are
+     * converted, so they don't wait up to a whole audio block for processBlock. Only meant for the Standalone build,
+     * where there is no host to route the plugin's MIDI output anyway.
+     *
+     * Notes sent here never pass through processBlock, so nothing else knows they are sounding. The port remembers
+     * which channels had a note on and sends them all notes off when it is closed.
+     */
+    class DirectMidiOutput
+    {
+    public:
+        ~DirectMidiOutput()
+        {
+            close();
+        }
+
+        // Message thread
+        bool open (const juce::String& portName)
+        {
+            close();
+
+#if BIRDHOUSE_HAS_VIRTUAL_MIDI_PORTS
+            mOutput = juce::MidiOutput::createNewDevice (portName);
+#else
+            juce::ignoreUnused (portName);
+#endif
+
+            if (mOutput == nullptr)
+            {
+                DBG ("DirectMidiOutput: could not create the port " + portName);
+                return false;
+            }
+
+            return true;
+        }
+
+        // Message thread, only after the bridge has stopped sending to it (see OSCBridgeManager::setDirectMidiOutput)
+        void close()
+        {
+            if (mOutput == nullptr)
+            {
+                return;
+            }
+
+            const auto channelsWithNotes = mChannelsWithNotes.exchange (0);
+
+            for (auto midiChannel = 1; midiChannel <= 16; ++midiChannel)
+            {
+                if ((channelsWithNotes & (1u << (midiChannel - 1))) != 0)
+                {
+                    const auto event = MidiEvent::allNotesOff (midiChannel);
+                    mOutput->sendMessageNow (juce::MidiMessage (event.bytes.data(), static_cast<int> (event.numBytes)));
+                }
+            }
+
+            mOutput.reset();
+        }
+
+        auto isOpen() const { return mOutput != nullptr; }
+
+        // The identifier of the port, for opening it from the other end
+        juce::String getIdentifier() const
+        {
+            return mOutput != nullptr ? mOutput->getIdentifier() : juce::String();
+        }
+
+        // The name other applications see the port under
+        juce::String getName() const
+        {
+            return mOutput != nullptr ? mOutput->getName() : juce::String();
+        }
+
+        // OSC dispatch. A juce::MidiMessage of up to 8 bytes doesn't allocate.
+        void send (const MidiEvent& event)
+        {
+            if ((event.status() & 0xf0) == 0x90 && event.data2() > 0)
+            {
+                mChannelsWithNotes.fetch_or (1u << (event.channel() - 1), std::memory_order_relaxed);
+            }
+
+            mOutput->sendMessageNow (juce::MidiMessage (event.bytes.data(), static_cast<int> (event.numBytes)));
+            mNumEventsSent.fetch_add (1, std::memory_order_relaxed);
+        }
+
+        auto getNumEventsSent() const { return mNumEventsSent.load(); }
+
+        // Bit n is set once MIDI channel n + 1 had a note on since the port was last closed
+        auto getChannelsWithNotes() const { return mChannelsWithNotes.load(); }
+
+    private:
+        std::unique_ptr<juce::MidiOutput> mOutput;
+        std::atomic<int> mNumEventsSent { 0 };
+
+        // Bit n is set once MIDI channel n + 1 had a note on, see close
+        std::atomic<juce::uint32> mChannelsWithNotes { 0 };
+    };
+}
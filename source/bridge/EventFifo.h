@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <juce_core/juce_core.h>
+
+namespace birdhouse
+{
+    /**
+     * @class EventFifo
+     * @brief Preallocated single producer, single consumer queue of small trivially copyable events
+     *
+     * Used to hand events from the OSC dispatch to the audio thread without locks or allocation.
+     */
+    template <typename Event, int Capacity = 1024>
+    class EventFifo
+    {
+    public:
+        static_assert (std::is_trivially_copyable_v<Event>);
+
+        // Returns false if the queue is full and the event was dropped
+        bool push (const Event& event)
+        {
+            const auto scope = mFifo.write (1);
+
+            if (scope.blockSize1 + scope.blockSize2 == 0)
+            {
+                return false;
+            }
+
+            mEvents[static_cast<std::size_t> (scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)] = event;
+            return true;
+        }
+
+        // Hands everything that is ready to onEvents (const Event*, int numEvents), in at most two contiguous runs
+        template <typename EventsCallback>
+        void popAll (EventsCallback&& onEvents)
+        {
+            const auto scope = mFifo.read (mFifo.getNumReady());
+
+            if (scope.blockSize1 > 0)
+            {
+                onEvents (mEvents.data() + scope.startIndex1, scope.blockSize1);
+            }
+
+            if (scope.blockSize2 > 0)
+            {
+                onEvents (mEvents.data() + scope.startIndex2, scope.blockSize2);
+            }
+        }
+
+        auto getNumReady() const { return mFifo.getNumReady(); }
+
+    private:
+        juce::AbstractFifo mFifo { Capacity };
+        std::array<Event, static_cast<std::size_t> (Capacity)> mEvents {};
+    };
+}
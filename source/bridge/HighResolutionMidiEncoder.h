@@ -0,0 +1,152 @@
+#pragma once
+
+#include "MidiEvent.h"
+#include <array>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace birdhouse
+{
+    /**
+     * @class MidiParameterSelection
+     * @brief Remembers which RPN/NRPN each output MIDI channel currently has selected
+     *
+     * Shared by all bridge channels of one output stream, so the parameter select (CC 99/98 or 101/100) is only sent
+     * when it actually changes. A selection is only reused by the bridge channel that made it: events from one bridge
+     * channel stay together in the output, but events from different bridge channels may be reordered.
+     * Only used from the OSC dispatch, which is serialised by OSCBridgeManager.
+     */
+    class MidiParameterSelection
+    {
+    public:
+        // Returns true if owner already has this parameter selected on the channel, otherwise records the new selection
+        bool select (int midiChannel, const void* owner, bool registered, int number)
+        {
+            auto& entry = mEntries[static_cast<std::size_t> (juce::jlimit (1, 16, midiChannel) - 1)];
+
+            if (entry.owner == owner && entry.registered == registered && entry.number == number)
+            {
+                return true;
+            }
+
+            entry = { owner, number, registered };
+            return false;
+        }
+
+        void invalidateAll()
+        {
+            mEntries.fill ({});
+        }
+
+    private:
+        struct Entry
+        {
+            const void* owner { nullptr };
+            int number { -1 };
+            bool registered { false };
+        };
+
+        std::array<Entry, 16> mEntries {};
+    };
+
+    /**
+     * @class HighResolutionMidiEncoder
+     * @brief Encodes a normalized value as a 14 bit MIDI 1.0 controller pair or as an RPN/NRPN data entry
+     *
+     * Keeps the last value sent, so that an unchanged value sends nothing and an unchanged LSB is skipped. All
+     * messages of one value are control changes on the same channel, so a MIDI 1.0 serializer can use running status
+     * for everything after the first one.
+     */
+    class HighResolutionMidiEncoder
+    {
+    public:
+        static constexpr int maxValue = 16383;
+
+        static int toFourteenBit (float normalizedValue)
+        {
+            return juce::roundToInt (juce::jlimit (0.0f, 1.0f, normalizedValue) * static_cast<float> (maxValue));
+        }
+
+        // 14 bit control change. The controller is the MSB number (0 - 31), the LSB goes to controller + 32.
+        template <typename Sink>
+        void encodeController (float normalizedValue, int midiChannel, int controller, Sink&& sink)
+        {
+            jassert (controller >= 0 && controller < 32);
+
+            prepare (midiChannel, controller, Kind::Controller);
+            send (toFourteenBit (normalizedValue), midiChannel, controller, controller + 32, false, sink);
+        }
+
+        // RPN (registered) or NRPN data entry. The parameter number may use the full 14 bits.
+        template <typename Sink>
+        void encodeParameter (float normalizedValue, int midiChannel, int parameter, bool registered, MidiParameterSelection& selection, Sink&& sink)
+        {
+            prepare (midiChannel, parameter, registered ? Kind::Registered : Kind::NonRegistered);
+
+            const auto alreadySelected = selection.select (midiChannel, this, registered, parameter);
+
+            if (!alreadySelected)
+            {
+                sink (MidiEvent::controller (midiChannel, registered ? 101 : 99, (parameter >> 7) & 0x7f));
+                sink (MidiEvent::controller (midiChannel, registered ? 100 : 98, parameter & 0x7f));
+            }
+
+            send (toFourteenBit (normalizedValue), midiChannel, 6, 38, !alreadySelected, sink);
+        }
+
+        void reset()
+        {
+            mLastValue = -1;
+        }
+
+    private:
+        enum class Kind {
+            Controller,
+            Registered,
+            NonRegistered
+        };
+
+        template <typename Sink>
+        void send (int value, int midiChannel, int msbController, int lsbController, bool forceFullValue, Sink&& sink)
+        {
+            if (!forceFullValue && value == mLastValue)
+            {
+                return;
+            }
+
+            const auto msb = value >> 7;
+            const auto lsb = value & 0x7f;
+
+            // Receivers reset the LSB to 0 when they get a new MSB, so a changed MSB is always followed by its LSB
+            const auto msbChanged = forceFullValue || mLastValue < 0 || msb != (mLastValue >> 7);
+            const auto lsbChanged = msbChanged || lsb != (mLastValue & 0x7f);
+
+            if (msbChanged)
+            {
+                sink (MidiEvent::controller (midiChannel, msbController, msb));
+            }
+
+            if (lsbChanged)
+            {
+                sink (MidiEvent::controller (midiChannel, lsbController, lsb));
+            }
+
+            mLastValue = value;
+        }
+
+        // Forget the last value when the output mapping changes
+        void prepare (int midiChannel, int number, Kind kind)
+        {
+            if (midiChannel != mLastChannel || number != mLastNumber || kind != mLastKind)
+            {
+                mLastChannel = midiChannel;
+                mLastNumber = number;
+                mLastKind = kind;
+                reset();
+            }
+        }
+
+        int mLastValue { -1 };
+        int mLastChannel { -1 }, mLastNumber { -1 };
+        Kind mLastKind { Kind::Controller };
+    };
+}
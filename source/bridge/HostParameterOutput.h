@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <vector>
+
+namespace birdhouse
+{
+    /**
+     * @class HostParameterOutput
+     * @brief Writes channel values to automatable host parameters, for targets that can't be MIDI learned
+     *
+     * Called once per block from processBlock with each channel's latest value, so however fast the OSC arrives a
+     * parameter changes at most once per block. On top of that each parameter waits for a minimum interval between
+     * writes and ignores changes too small to matter, which keeps the host's automation system from being swamped.
+     */
+    class HostParameterOutput
+    {
+    public:
+        // Message thread, while setting up. The parameters are owned by the processor.
+        void addParameter (juce::RangedAudioParameter* parameter)
+        {
+            jassert (parameter != nullptr);
+            mOutputs.push_back ({ parameter });
+        }
+
+        void prepare (double sampleRate)
+        {
+            mSampleRate = sampleRate;
+
+            for (auto& output : mOutputs)
+            {
+                output.samplesSinceWrite = std::numeric_limits<int>::max() / 2;
+            }
+        }
+
+        void setMinimumInterval (float newIntervalMs) { mMinimumIntervalMs.store (juce::jmax (0.f, newIntervalMs)); }
+
+        // Audio thread, once per block for every parameter that follows its channel
+        void write (int index, float normalizedValue, int numSamples)
+        {
+            auto& output = mOutputs[static_cast<std::size_t> (index)];
+            output.samplesSinceWrite = juce::jmin (output.samplesSinceWrite + numSamples, std::numeric_limits<int>::max() / 2);
+
+            const auto minimumInterval = static_cast<int> (mMinimumIntervalMs.load() * 0.001 * mSampleRate);
+
+            if (output.samplesSinceWrite < minimumInterval || std::abs (normalizedValue - output.lastValue) < minimumChange)
+            {
+                return;
+            }
+
+            output.parameter->setValueNotifyingHost (normalizedValue);
+            output.lastValue = normalizedValue;
+            output.samplesSinceWrite = 0;
+        }
+
+        auto getNumParameters() const { return static_cast<int> (mOutputs.size()); }
+
+    private:
+        // Finer than any host's automation display, and than 7 bit MIDI
+        static constexpr float minimumChange = 1.0f / 1024.0f;
+
+        struct Output
+        {
+            juce::RangedAudioParameter* parameter { nullptr };
+            float lastValue { -1.0f };
+            int samplesSinceWrite { 0 };
+        };
+
+        std::vector<Output> mOutputs;
+        double mSampleRate { 44100.0 };
+        std::atomic<float> mMinimumIntervalMs { 20.f };
+    };
+}
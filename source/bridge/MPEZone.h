@@ -0,0 +1,339 @@
+#pragma once
+
+#include "MidiEvent.h"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <juce_core/juce_core.h>
+#include <memory>
+
+namespace birdhouse
+{
+    /**
+     * @class MPEVoicePool
+     * @brief Lock-free allocation of the MPE member channels, shared by all MPE channels of the bridge
+     *
+     * Birdhouse uses the lower zone (manager channel 1, members from channel 2 up) and the upper zone (manager channel
+     * 16, members from channel 15 down). When only one of them is in use it gets all 15 member channels, when both
+     * are they get 7 each. Bridge channels in the same zone take their member channels from the same pool, so no two
+     * notes ever share a channel.
+     *
+     * One bit per free MIDI channel. Channels are taken by the OSC thread when a touch starts and given back by the
+     * audio thread once the note off has actually been sent, so a channel is never reused while its note still sounds.
+     */
+    class MPEVoicePool
+    {
+    public:
+        enum Zone {
+            LowerZone,
+            UpperZone
+        };
+
+        static constexpr int numMemberChannels = 15;
+
+        static int managerChannel (Zone zone) { return zone == UpperZone ? 16 : 1; }
+
+        // Any thread. Sets which zones the bridge channels use, changing the member channels of each.
+        void setZonesInUse (bool lower, bool upper)
+        {
+            const auto layout = (lower ? 1 : 0) | (upper ? 2 : 0);
+
+            if (mLayout.exchange (layout) != layout)
+            {
+                mLayoutGeneration.fetch_add (1);
+            }
+        }
+
+        int getNumMemberChannels (Zone zone) const
+        {
+            const auto layout = mLayout.load();
+            const auto inUse = (layout & (zone == UpperZone ? 2 : 1)) != 0;
+            const auto otherInUse = (layout & (zone == UpperZone ? 1 : 2)) != 0;
+
+            // Without any MPE channel yet, a lone zone is what it will most likely be
+            return otherInUse ? (inUse ? numMemberChannels / 2 : 0) : numMemberChannels;
+        }
+
+        // Changes whenever the member channels of the zones change, so they can be announced again
+        auto getLayoutGeneration() const { return mLayoutGeneration.load(); }
+
+        // Returns the member channel, or -1 if all of the zone's are in use
+        int allocate (Zone zone)
+        {
+            const auto numMembers = getNumMemberChannels (zone);
+            const auto zoneBits = ((juce::uint32 { 1 } << numMembers) - 1) << (zone == UpperZone ? numMemberChannels - numMembers : 1);
+            auto free = mFree.load (std::memory_order_relaxed);
+
+            while ((free & zoneBits) != 0)
+            {
+                // Lower zone members count up from channel 2, upper zone members down from channel 15
+                const auto available = free & zoneBits;
+                const auto bit = zone == UpperZone ? 31 - std::countl_zero (available) : std::countr_zero (available);
+
+                if (mFree.compare_exchange_weak (free, free & ~(juce::uint32 { 1 } << bit), std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    return bit + 1;
+                }
+            }
+
+            return -1;
+        }
+
+        void release (int midiChannel)
+        {
+            mFree.fetch_or (juce::uint32 { 1 } << (midiChannel - 1), std::memory_order_release);
+        }
+
+        auto getNumFree() const { return std::popcount (mFree.load()); }
+
+    private:
+        // Bit n is MIDI channel n + 1. Which of them a zone may take depends on the layout, see allocate.
+        std::atomic<juce::uint32> mFree { 0xffff };
+        std::atomic<int> mLayout { 0 };
+        std::atomic<int> mLayoutGeneration { 0 };
+    };
+
+    /**
+     * @class MPEZone
+     * @brief Turns touches with x, y and pressure into MPE notes with per-note pitch bend, timbre and pressure
+     *
+     * touch() is called from the OSC dispatch and only stores the latest values in the touch's voice. The audio thread
+     * then writes every voice that changed in one pass per block, without allocating. Pitch bend is relative to where
+     * the touch started, so each note starts in tune; y goes to CC 74 and pressure to channel pressure.
+     */
+    class MPEZone
+    {
+    public:
+        static constexpr int maxTouches = 64;
+
+        // Message thread, before the first touch. Shares the member channels with the other MPE channels.
+        void setVoicePool (std::shared_ptr<MPEVoicePool> pool)
+        {
+            mPool = std::move (pool);
+        }
+
+        // OSC thread, before touch(). A new zone applies to the touches that start after it.
+        void setZone (MPEVoicePool::Zone zone)
+        {
+            mZone.store (zone, std::memory_order_relaxed);
+        }
+
+        // OSC thread. A pressure of 0 or less ends the touch.
+        void touch (int touchId, int note, float x, float y, float pressure)
+        {
+            if (touchId < 0 || touchId >= maxTouches)
+            {
+                return;
+            }
+
+            auto& voiceChannel = mTouchChannels[static_cast<std::size_t> (touchId)];
+
+            // The audio thread may have released the voice in the meantime, see releaseAll
+            if (voiceChannel > 0 && voiceFor (voiceChannel).touchId.load (std::memory_order_acquire) != touchId)
+            {
+                voiceChannel = -1;
+            }
+
+            if (pressure <= 0.f)
+            {
+                if (voiceChannel > 0)
+                {
+                    voiceFor (voiceChannel).flags.fetch_or (NoteOffPending, std::memory_order_release);
+                    voiceChannel = -1;
+                }
+
+                return;
+            }
+
+            juce::uint32 flags = 0;
+
+            if (voiceChannel < 0)
+            {
+                voiceChannel = mPool->allocate (mZone.load (std::memory_order_relaxed));
+
+                if (voiceChannel < 0)
+                {
+                    DBG ("MPEZone: no free member channel, dropped touch " + juce::String (touchId));
+                    return;
+                }
+
+                // A touch that lost this voice to releaseAll in the middle of touch() may still have flagged it after
+                // it was freed, e.g. with a note off. That belongs to the old note, not to this one.
+                auto& voice = voiceFor (voiceChannel);
+                voice.flags.exchange (0, std::memory_order_acquire);
+                voice.note.store (note, std::memory_order_relaxed);
+                voice.xStart.store (x, std::memory_order_relaxed);
+                voice.touchId.store (touchId, std::memory_order_relaxed);
+                mNumActiveVoices.fetch_add (1);
+                flags = NoteOnPending | BendDirty | TimbreDirty | PressureDirty;
+            }
+
+            // Only the dimensions that moved are sent again
+            auto& voice = voiceFor (voiceChannel);
+            flags |= voice.x.load (std::memory_order_relaxed) != x ? BendDirty : 0u;
+            flags |= voice.y.load (std::memory_order_relaxed) != y ? TimbreDirty : 0u;
+            flags |= voice.pressure.load (std::memory_order_relaxed) != pressure ? PressureDirty : 0u;
+
+            if (flags == 0)
+            {
+                return;
+            }
+
+            voice.x.store (x, std::memory_order_relaxed);
+            voice.y.store (y, std::memory_order_relaxed);
+            voice.pressure.store (pressure, std::memory_order_relaxed);
+            voice.flags.fetch_or (flags, std::memory_order_release);
+        }
+
+        // Audio thread. Calls sink (const MidiEvent&) for everything that changed since the last block.
+        template <typename Sink>
+        void render (Sink&& sink)
+        {
+            const auto zone = mZone.load (std::memory_order_relaxed);
+            const auto generation = mPool->getLayoutGeneration();
+
+            if (!mConfigurationSent || zone != mConfiguredZone || generation != mConfiguredGeneration)
+            {
+                // MPE configuration message (RPN 6) on the manager channel, then deselect the RPN again
+                const auto managerChannel = MPEVoicePool::managerChannel (zone);
+                sink (MidiEvent::controller (managerChannel, 101, 0));
+                sink (MidiEvent::controller (managerChannel, 100, 6));
+                sink (MidiEvent::controller (managerChannel, 6, mPool->getNumMemberChannels (zone)));
+                sink (MidiEvent::controller (managerChannel, 101, 127));
+                sink (MidiEvent::controller (managerChannel, 100, 127));
+                mConfigurationSent = true;
+                mConfiguredZone = zone;
+                mConfiguredGeneration = generation;
+            }
+
+            for (auto midiChannel = 1; midiChannel <= 16; ++midiChannel)
+            {
+                auto& voice = voiceFor (midiChannel);
+                const auto flags = voice.flags.exchange (0, std::memory_order_acquire);
+
+                // Changes that arrive for a voice just after releaseAll are dropped with it
+                if (flags == 0 || (!voice.sounding && (flags & NoteOnPending) == 0))
+                {
+                    continue;
+                }
+
+                const auto note = voice.note.load (std::memory_order_relaxed);
+                const auto pressure = toSevenBit (voice.pressure.load (std::memory_order_relaxed));
+
+                // Per-note controls go out before the note on, so the note starts with the right expression
+                if ((flags & BendDirty) != 0)
+                {
+                    const auto offset = voice.x.load (std::memory_order_relaxed) - voice.xStart.load (std::memory_order_relaxed);
+                    sink (MidiEvent::pitchBend (midiChannel, juce::jlimit (0, 16383, 8192 + juce::roundToInt (offset * 8191.f))));
+                }
+
+                if ((flags & TimbreDirty) != 0)
+                {
+                    sink (MidiEvent::controller (midiChannel, 74, toSevenBit (voice.y.load (std::memory_order_relaxed))));
+                }
+
+                if ((flags & PressureDirty) != 0)
+                {
+                    sink (MidiEvent::channelPressure (midiChannel, pressure));
+                }
+
+                if ((flags & NoteOnPending) != 0)
+                {
+                    sink (MidiEvent::noteOn (midiChannel, note, juce::jmax (1, pressure)));
+                    voice.sounding = true;
+                }
+
+                if ((flags & NoteOffPending) != 0)
+                {
+                    sink (MidiEvent::noteOff (midiChannel, note));
+                    freeVoice (midiChannel);
+                }
+            }
+        }
+
+        // Audio thread. Sends note offs for every sounding voice and gives their channels back, e.g. after a mapping
+        // change. The configuration is announced again with the next render.
+        template <typename Sink>
+        void releaseAll (Sink&& sink)
+        {
+            for (auto midiChannel = 1; midiChannel <= 16; ++midiChannel)
+            {
+                auto& voice = voiceFor (midiChannel);
+                const auto flags = voice.flags.exchange (0, std::memory_order_acquire);
+
+                if (voice.sounding)
+                {
+                    sink (MidiEvent::noteOff (midiChannel, voice.note.load (std::memory_order_relaxed)));
+                }
+
+                if (voice.sounding || (flags & NoteOnPending) != 0)
+                {
+                    freeVoice (midiChannel);
+                }
+            }
+
+            mConfigurationSent = false;
+        }
+
+        auto getNumActiveVoices() const { return mNumActiveVoices.load(); }
+
+    private:
+        static constexpr juce::uint32 NoteOnPending = 1 << 0;
+        static constexpr juce::uint32 NoteOffPending = 1 << 1;
+        static constexpr juce::uint32 BendDirty = 1 << 2;
+        static constexpr juce::uint32 TimbreDirty = 1 << 3;
+        static constexpr juce::uint32 PressureDirty = 1 << 4;
+
+        struct Voice
+        {
+            std::atomic<float> x { 0.f }, y { 0.f }, pressure { 0.f }, xStart { 0.f };
+            std::atomic<int> note { 0 };
+            std::atomic<int> touchId { -1 };
+            std::atomic<juce::uint32> flags { 0 };
+
+            // Audio thread only
+            bool sounding { false };
+        };
+
+        static int toSevenBit (float normalizedValue)
+        {
+            return juce::roundToInt (juce::jlimit (0.f, 1.f, normalizedValue) * 127.f);
+        }
+
+        Voice& voiceFor (int midiChannel)
+        {
+            return mVoices[static_cast<std::size_t> (midiChannel - 1)];
+        }
+
+        // Audio thread. The touch loses the voice before the channel can go to another one.
+        void freeVoice (int midiChannel)
+        {
+            auto& voice = voiceFor (midiChannel);
+            voice.sounding = false;
+            voice.touchId.store (-1, std::memory_order_release);
+            mNumActiveVoices.fetch_sub (1);
+            mPool->release (midiChannel);
+        }
+
+        // Indexed by MIDI channel, only the member channels this zone allocated are used
+        std::array<Voice, 16> mVoices;
+        std::shared_ptr<MPEVoicePool> mPool { std::make_shared<MPEVoicePool>() };
+        std::atomic<MPEVoicePool::Zone> mZone { MPEVoicePool::LowerZone };
+        std::atomic<int> mNumActiveVoices { 0 };
+
+        // Member channel of each touch id, OSC thread only
+        std::array<int, maxTouches> mTouchChannels { makeEmptyTouchChannels() };
+
+        // Audio thread only
+        bool mConfigurationSent { false };
+        MPEVoicePool::Zone mConfiguredZone { MPEVoicePool::LowerZone };
+        int mConfiguredGeneration { 0 };
+
+        static constexpr std::array<int, maxTouches> makeEmptyTouchChannels()
+        {
+            std::array<int, maxTouches> channels {};
+            channels.fill (-1);
+            return channels;
+        }
+    };
+}
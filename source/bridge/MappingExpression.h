@@ -0,0 +1,492 @@
+#pragma once
+
+#include "PublishedValue.h"
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <juce_core/juce_core.h>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace birdhouse
+{
+    /**
+     * @class MappingExpression
+     * @brief A small per channel formula like 1 - x or clamp (x * 2 - 0.5), compiled to flat bytecode
+     *
+     * x is the channel's normalized value and y the normalized second argument of the message, if there is one.
+     * Supports + - * / ^, parentheses, numbers and abs, sqrt, floor, min, max, pow and clamp (x) or clamp (x, lo, hi).
+     *
+     * The text is parsed once when it is set, on the message thread, into a fixed size array of stack machine
+     * instructions. Evaluating is a loop over that array with a stack on the stack, so it never allocates and its
+     * cost only depends on the length of the formula. New formulas are published with a PublishedValue, so the OSC
+     * thread never sees a half written program.
+     */
+    class MappingExpression
+    {
+    public:
+        static constexpr int maxInstructions = 64;
+        static constexpr int maxStackDepth = 16;
+
+        enum class OpCode : juce::uint8 {
+            Constant,
+            X,
+            Y,
+            Add,
+            Subtract,
+            Multiply,
+            Divide,
+            Power,
+            Negate,
+            Abs,
+            Sqrt,
+            Floor,
+            Min,
+            Max,
+            Clamp01,
+            Clamp
+        };
+
+        struct Instruction
+        {
+            OpCode op { OpCode::X };
+            float constant { 0.f };
+        };
+
+        struct Program
+        {
+            std::array<Instruction, maxInstructions> instructions {};
+            int numInstructions { 0 };
+            bool usesY { false };
+
+            // An empty program passes x through
+            float evaluate (float x, float y) const
+            {
+                if (numInstructions == 0)
+                {
+                    return x;
+                }
+
+                std::array<float, maxStackDepth> stack;
+                auto top = -1;
+
+                for (auto i = 0; i < numInstructions; ++i)
+                {
+                    const auto& instruction = instructions[static_cast<std::size_t> (i)];
+
+                    switch (instruction.op)
+                    {
+                        case OpCode::Constant: stack[static_cast<std::size_t> (++top)] = instruction.constant; break;
+                        case OpCode::X: stack[static_cast<std::size_t> (++top)] = x; break;
+                        case OpCode::Y: stack[static_cast<std::size_t> (++top)] = y; break;
+                        case OpCode::Negate: stack[static_cast<std::size_t> (top)] = -stack[static_cast<std::size_t> (top)]; break;
+                        case OpCode::Abs: stack[static_cast<std::size_t> (top)] = std::abs (stack[static_cast<std::size_t> (top)]); break;
+                        case OpCode::Sqrt: stack[static_cast<std::size_t> (top)] = std::sqrt (juce::jmax (0.f, stack[static_cast<std::size_t> (top)])); break;
+                        case OpCode::Floor: stack[static_cast<std::size_t> (top)] = std::floor (stack[static_cast<std::size_t> (top)]); break;
+                        case OpCode::Clamp01: stack[static_cast<std::size_t> (top)] = juce::jlimit (0.f, 1.f, stack[static_cast<std::size_t> (top)]); break;
+                        case OpCode::Clamp:
+                        {
+                            top -= 2;
+                            const auto index = static_cast<std::size_t> (top);
+                            stack[index] = juce::jmin (juce::jmax (stack[index], stack[index + 1]), stack[index + 2]);
+                            break;
+                        }
+                        case OpCode::Add:
+                        case OpCode::Subtract:
+                        case OpCode::Multiply:
+                        case OpCode::Divide:
+                        case OpCode::Power:
+                        case OpCode::Min:
+                        case OpCode::Max:
+                        default:
+                        {
+                            const auto b = stack[static_cast<std::size_t> (top--)];
+                            auto& a = stack[static_cast<std::size_t> (top)];
+                            a = binary (instruction.op, a, b);
+                            break;
+                        }
+                    }
+                }
+
+                // A division by 0 is no reason to send garbage MIDI
+                return std::isfinite (stack[0]) ? stack[0] : 0.f;
+            }
+
+        private:
+            static float binary (OpCode op, float a, float b)
+            {
+                switch (op)
+                {
+                    case OpCode::Add: return a + b;
+                    case OpCode::Subtract: return a - b;
+                    case OpCode::Multiply: return a * b;
+                    case OpCode::Divide: return a / b;
+                    case OpCode::Power: return std::pow (a, b);
+                    case OpCode::Min: return juce::jmin (a, b);
+                    case OpCode::Max: return juce::jmax (a, b);
+                    case OpCode::Constant:
+                    case OpCode::X:
+                    case OpCode::Y:
+                    case OpCode::Negate:
+                    case OpCode::Abs:
+                    case OpCode::Sqrt:
+                    case OpCode::Floor:
+                    case OpCode::Clamp01:
+                    case OpCode::Clamp:
+                    default: return a;
+                }
+            }
+        };
+
+        // Parses text into a program, or returns nothing and describes the problem in errorMessage
+        static std::optional<Program> compile (const juce::String& text, juce::String& errorMessage)
+        {
+            Compiler compiler (text.toStdString());
+            auto program = compiler.run();
+
+            if (!program.has_value())
+            {
+                errorMessage = compiler.error;
+            }
+
+            return program;
+        }
+
+        // Message thread. An empty or broken formula passes the value through unchanged.
+        bool set (const juce::String& text)
+        {
+            if (text == mText)
+            {
+                return true;
+            }
+
+            mText = text;
+
+            auto errorMessage = juce::String();
+            auto program = text.trim().isEmpty() ? std::optional<Program> (Program {}) : compile (text, errorMessage);
+
+            if (!program.has_value())
+            {
+                DBG ("MappingExpression: can't use \"" + text + "\": " + errorMessage);
+                program = Program {};
+            }
+
+            mProgram.publish (*program);
+
+            return errorMessage.isEmpty();
+        }
+
+        // Any thread
+        float evaluate (float x, float y = 0.f) const
+        {
+            return mProgram.read()->evaluate (x, y);
+        }
+
+        auto usesSecondArgument() const { return mProgram.read()->usesY; }
+
+        auto isPassThrough() const { return mProgram.read()->numInstructions == 0; }
+
+    private:
+        // Recursive descent straight into postfix:
+        // expression = term { (+ | -) term }, term = unary { (* | /) unary }, unary = - unary | power,
+        // power = primary [ ^ unary ], primary = number | x | y | function ( arguments ) | ( expression )
+        struct Compiler
+        {
+            explicit Compiler (std::string textToParse) : text (std::move (textToParse)) {}
+
+            std::optional<Program> run()
+            {
+                expression();
+                skipSpaces();
+
+                if (error.isEmpty() && position < text.size())
+                {
+                    fail ("unexpected '" + juce::String::charToString (static_cast<juce::juce_wchar> (text[position])) + "'");
+                }
+
+                if (error.isNotEmpty())
+                {
+                    return std::nullopt;
+                }
+
+                return program;
+            }
+
+            void expression()
+            {
+                term();
+
+                while (error.isEmpty())
+                {
+                    if (accept ('+'))
+                    {
+                        term();
+                        emit (OpCode::Add);
+                    }
+                    else if (accept ('-'))
+                    {
+                        term();
+                        emit (OpCode::Subtract);
+                    }
+                    else
+                    {
+                        return;
+                    }
+                }
+            }
+
+            void term()
+            {
+                unary();
+
+                while (error.isEmpty())
+                {
+                    if (accept ('*'))
+                    {
+                        unary();
+                        emit (OpCode::Multiply);
+                    }
+                    else if (accept ('/'))
+                    {
+                        unary();
+                        emit (OpCode::Divide);
+                    }
+                    else
+                    {
+                        return;
+                    }
+                }
+            }
+
+            void unary()
+            {
+                if (accept ('-'))
+                {
+                    unary();
+                    emit (OpCode::Negate);
+                    return;
+                }
+
+                primary();
+
+                if (accept ('^'))
+                {
+                    unary();
+                    emit (OpCode::Power);
+                }
+            }
+
+            void primary()
+            {
+                skipSpaces();
+
+                if (error.isNotEmpty())
+                {
+                    return;
+                }
+
+                if (position >= text.size())
+                {
+                    fail ("unexpected end");
+                    return;
+                }
+
+                const auto c = text[position];
+
+                if (std::isdigit (static_cast<unsigned char> (c)) || c == '.')
+                {
+                    number();
+                }
+                else if (std::isalpha (static_cast<unsigned char> (c)))
+                {
+                    name();
+                }
+                else if (accept ('('))
+                {
+                    expression();
+                    expect (')');
+                }
+                else
+                {
+                    fail ("unexpected '" + juce::String::charToString (static_cast<juce::juce_wchar> (c)) + "'");
+                }
+            }
+
+            void number()
+            {
+                const auto start = position;
+
+                while (position < text.size() && (std::isdigit (static_cast<unsigned char> (text[position])) || text[position] == '.'))
+                {
+                    ++position;
+                }
+
+                emit (OpCode::Constant, juce::String (text.substr (start, position - start)).getFloatValue());
+            }
+
+            void name()
+            {
+                const auto start = position;
+
+                while (position < text.size() && std::isalnum (static_cast<unsigned char> (text[position])))
+                {
+                    ++position;
+                }
+
+                const auto identifier = text.substr (start, position - start);
+
+                if (identifier == "x")
+                {
+                    emit (OpCode::X);
+                    return;
+                }
+
+                if (identifier == "y")
+                {
+                    program.usesY = true;
+                    emit (OpCode::Y);
+                    return;
+                }
+
+                expect ('(');
+                const auto numArguments = arguments();
+
+                struct Function
+                {
+                    const char* name;
+                    int numArguments;
+                    OpCode op;
+                };
+
+                static constexpr std::array<Function, 8> functions { {
+                    { "abs", 1, OpCode::Abs },
+                    { "sqrt", 1, OpCode::Sqrt },
+                    { "floor", 1, OpCode::Floor },
+                    { "clamp", 1, OpCode::Clamp01 },
+                    { "clamp", 3, OpCode::Clamp },
+                    { "min", 2, OpCode::Min },
+                    { "max", 2, OpCode::Max },
+                    { "pow", 2, OpCode::Power },
+                } };
+
+                for (const auto& function : functions)
+                {
+                    if (identifier == function.name && numArguments == function.numArguments)
+                    {
+                        emit (function.op);
+                        return;
+                    }
+                }
+
+                fail ("unknown function " + juce::String (identifier) + " with " + juce::String (numArguments) + " arguments");
+            }
+
+            // After the opening parenthesis, up to and including the closing one
+            int arguments()
+            {
+                auto numArguments = 0;
+
+                do
+                {
+                    expression();
+                    ++numArguments;
+                } while (error.isEmpty() && accept (','));
+
+                expect (')');
+                return numArguments;
+            }
+
+            void emit (OpCode op, float constant = 0.f)
+            {
+                if (error.isNotEmpty())
+                {
+                    return;
+                }
+
+                if (program.numInstructions == maxInstructions)
+                {
+                    fail ("too long");
+                    return;
+                }
+
+                switch (op)
+                {
+                    case OpCode::Constant:
+                    case OpCode::X:
+                    case OpCode::Y: ++depth; break;
+                    case OpCode::Clamp: depth -= 2; break;
+                    case OpCode::Add:
+                    case OpCode::Subtract:
+                    case OpCode::Multiply:
+                    case OpCode::Divide:
+                    case OpCode::Power:
+                    case OpCode::Min:
+                    case OpCode::Max: --depth; break;
+                    case OpCode::Negate:
+                    case OpCode::Abs:
+                    case OpCode::Sqrt:
+                    case OpCode::Floor:
+                    case OpCode::Clamp01:
+                    default: break;
+                }
+
+                if (depth > maxStackDepth)
+                {
+                    fail ("nested too deeply");
+                    return;
+                }
+
+                program.instructions[static_cast<std::size_t> (program.numInstructions++)] = { op, constant };
+            }
+
+            void skipSpaces()
+            {
+                while (position < text.size() && std::isspace (static_cast<unsigned char> (text[position])))
+                {
+                    ++position;
+                }
+            }
+
+            bool accept (char c)
+            {
+                skipSpaces();
+
+                if (position < text.size() && text[position] == c)
+                {
+                    ++position;
+                    return true;
+                }
+
+                return false;
+            }
+
+            void expect (char c)
+            {
+                if (error.isEmpty() && !accept (c))
+                {
+                    fail ("expected '" + juce::String::charToString (static_cast<juce::juce_wchar> (c)) + "'");
+                }
+            }
+
+            void fail (const juce::String& message)
+            {
+                if (error.isEmpty())
+                {
+                    error = message + " at " + juce::String (static_cast<int> (position) + 1);
+                }
+            }
+
+            std::string text;
+            std::size_t position { 0 };
+            int depth { 0 };
+            Program program;
+            juce::String error;
+        };
+
+        PublishedValue<Program> mProgram;
+
+        // Message thread only
+        juce::String mText;
+    };
+}
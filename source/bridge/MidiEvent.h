@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+
+namespace birdhouse
+{
+    /**
+     * @class MidiEvent
+     * @brief A MIDI 1.0 channel message and its sample offset in 8 trivially copyable bytes
+     *
+     * This is what the bridge passes around between converting an OSC value and writing the host's MidiBuffer,
+     * instead of juce::MidiMessage with its double timestamp and possible heap allocation.
+     * midiChannel is 1 - 16 as everywhere else in the bridge.
+     */
+    struct MidiEvent
+    {
+        std::array<juce::uint8, 3> bytes {};
+        juce::uint8 numBytes { 0 };
+        juce::int32 sampleOffset { 0 };
+
+        auto status() const { return bytes[0]; }
+        auto data1() const { return bytes[1]; }
+        auto data2() const { return bytes[2]; }
+        auto channel() const { return (bytes[0] & 0x0f) + 1; }
+        auto isEmpty() const { return numBytes == 0; }
+
+        static MidiEvent channelMessage (juce::uint8 type, int midiChannel, int data1, int data2)
+        {
+            const auto channelBits = static_cast<juce::uint8> ((midiChannel - 1) & 0x0f);
+            return { { static_cast<juce::uint8> (type | channelBits), static_cast<juce::uint8> (data1 & 0x7f), static_cast<juce::uint8> (data2 & 0x7f) }, 3, 0 };
+        }
+
+        static MidiEvent singleDataMessage (juce::uint8 type, int midiChannel, int data1)
+        {
+            auto event = channelMessage (type, midiChannel, data1, 0);
+            event.numBytes = 2;
+            return event;
+        }
+
+        bool operator== (const MidiEvent& other) const
+        {
+            return numBytes == other.numBytes && bytes == other.bytes;
+        }
+
+        static MidiEvent noteOn (int midiChannel, int note, int velocity) { return channelMessage (0x90, midiChannel, note, velocity); }
+        static MidiEvent noteOff (int midiChannel, int note, int velocity = 0) { return channelMessage (0x80, midiChannel, note, velocity); }
+        static MidiEvent controller (int midiChannel, int controller, int value) { return channelMessage (0xb0, midiChannel, controller, value); }
+
+        // value is 0 - 16383, 8192 is centre
+        static MidiEvent pitchBend (int midiChannel, int value) { return channelMessage (0xe0, midiChannel, value & 0x7f, (value >> 7) & 0x7f); }
+
+        static MidiEvent polyPressure (int midiChannel, int note, int pressure) { return channelMessage (0xa0, midiChannel, note, pressure); }
+
+        // Channel pressure and program change only have one data byte
+        static MidiEvent channelPressure (int midiChannel, int pressure) { return singleDataMessage (0xd0, midiChannel, pressure); }
+        static MidiEvent programChange (int midiChannel, int program) { return singleDataMessage (0xc0, midiChannel, program); }
+
+        static MidiEvent allNotesOff (int midiChannel) { return controller (midiChannel, 123, 0); }
+    };
+
+    static_assert (std::is_trivially_copyable_v<MidiEvent> && sizeof (MidiEvent) == 8);
+}
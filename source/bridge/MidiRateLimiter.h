@@ -0,0 +1,130 @@
+#pragma once
+
+#include "MidiEvent.h"
+#include <array>
+#include <atomic>
+#include <juce_core/juce_core.h>
+
+namespace birdhouse
+{
+    /**
+     * @class MidiRateLimiter
+     * @brief Token buckets that cap the controller messages per second of each channel and of the whole output
+     *
+     * Every channel has its own bucket, and the output as a whole has one more. A message goes out if both have a
+     * token. Otherwise it is held back as the channel's pending message. A newer one replaces it, so when there is
+     * room again the receiver gets the latest value and not a backlog. Only meant for channels that send one message
+     * per value: continuous controllers, where skipping a value in between is harmless.
+     *
+     * The buckets are refilled once per block, so the cost per block is one loop over the channels, plus one check per
+     * message. Audio thread only, apart from the rate setters and getNumLimited.
+     */
+    template <int NumChannels>
+    class MidiRateLimiter
+    {
+    public:
+        void prepare (double sampleRate)
+        {
+            mSampleRate = sampleRate;
+
+            for (auto& bucket : mChannelBuckets)
+            {
+                bucket = {};
+            }
+
+            mOutputBucket = {};
+        }
+
+        // Messages per second, 0 is unlimited
+        void setChannelRate (int channel, float messagesPerSecond) { mChannelRates[static_cast<std::size_t> (channel)].store (juce::jmax (0.f, messagesPerSecond)); }
+        void setOutputRate (float messagesPerSecond) { mOutputRate.store (juce::jmax (0.f, messagesPerSecond)); }
+
+        // At the start of every block
+        void refill (int numSamples)
+        {
+            const auto seconds = static_cast<float> (numSamples / mSampleRate);
+
+            for (std::size_t channel = 0; channel < mChannelBuckets.size(); ++channel)
+            {
+                mChannelBuckets[channel].refill (mChannelRates[channel].load (std::memory_order_relaxed), seconds);
+            }
+
+            mOutputBucket.refill (mOutputRate.load (std::memory_order_relaxed), seconds);
+        }
+
+        // Returns true if the message can go out now. If not, it is kept as the channel's pending message.
+        bool admit (int channel, const juce::uint8* bytes, int numBytes)
+        {
+            auto& bucket = mChannelBuckets[static_cast<std::size_t> (channel)];
+
+            if (bucket.hasToken() && mOutputBucket.hasToken())
+            {
+                bucket.take();
+                mOutputBucket.take();
+
+                // Anything older that was still waiting is out of date now
+                bucket.pending = {};
+                return true;
+            }
+
+            std::copy (bytes, bytes + juce::jmin (numBytes, 3), bucket.pending.bytes.begin());
+            bucket.pending.numBytes = static_cast<juce::uint8> (juce::jmin (numBytes, 3));
+            mNumLimited[static_cast<std::size_t> (channel)].fetch_add (1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // After the channel's messages of the block. Calls write (const MidiEvent&) with its pending message, if
+        // there is one and there is room for it now.
+        template <typename WriteCallback>
+        void flushPending (int channel, WriteCallback&& write)
+        {
+            auto& bucket = mChannelBuckets[static_cast<std::size_t> (channel)];
+
+            if (bucket.pending.isEmpty() || !bucket.hasToken() || !mOutputBucket.hasToken())
+            {
+                return;
+            }
+
+            bucket.take();
+            mOutputBucket.take();
+            write (bucket.pending);
+            bucket.pending = {};
+        }
+
+        // How many messages of the channel were held back since the start, any thread
+        auto getNumLimited (int channel) const { return mNumLimited[static_cast<std::size_t> (channel)].load(); }
+
+    private:
+        struct Bucket
+        {
+            float tokens { 0.f };
+            bool unlimited { true };
+            MidiEvent pending;
+
+            // Holds up to 50 ms worth of messages, so a short burst still goes through in one go
+            void refill (float rate, float seconds)
+            {
+                unlimited = rate <= 0.f;
+                tokens = unlimited ? 0.f : juce::jmin (juce::jmax (1.f, rate * 0.05f), tokens + rate * seconds);
+            }
+
+            bool hasToken() const { return unlimited || tokens >= 1.f; }
+
+            void take()
+            {
+                if (!unlimited)
+                {
+                    tokens -= 1.f;
+                }
+            }
+        };
+
+        std::array<Bucket, NumChannels> mChannelBuckets {};
+        Bucket mOutputBucket;
+        double mSampleRate { 44100.0 };
+
+        std::array<std::atomic<float>, NumChannels> mChannelRates {};
+        std::atomic<float> mOutputRate { 0.f };
+        std::array<std::atomic<int>, NumChannels> mNumLimited {};
+    };
+}
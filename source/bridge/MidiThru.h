@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace birdhouse
+{
+    // Message types that can be let through, combined as a bit mask
+    enum MidiThruType {
+        ThruNotes = 1 << 0,
+        ThruPolyPressure = 1 << 1,
+        ThruControllers = 1 << 2,
+        ThruProgramChange = 1 << 3,
+        ThruChannelPressure = 1 << 4,
+        ThruPitchBend = 1 << 5,
+        ThruSystem = 1 << 6,
+        ThruAllTypes = (1 << 7) - 1
+    };
+
+    /**
+     * @class MidiThru
+     * @brief Lets the host's incoming MIDI through, merged with what the bridge writes
+     *
+     * At the start of the block the input is swapped into a preallocated buffer, which leaves the host's buffer
+     * empty for the bridge without copying anything. At the end the input events that pass the filter are added back
+     * in timestamp order, after any bridge events on the same sample. The two buffers trade their storage every block,
+     * so neither allocates once both have grown to the largest block seen.
+     */
+    class MidiThru
+    {
+    public:
+        static constexpr juce::uint16 allChannels = 0xffff;
+
+        // Message thread, before playback
+        void prepare (int numBytesToReserve)
+        {
+            mInput.ensureSize (static_cast<std::size_t> (numBytesToReserve));
+        }
+
+        void setEnabled (bool shouldBeEnabled) { mEnabled.store (shouldBeEnabled); }
+
+        // Bit 0 is MIDI channel 1
+        void setChannelMask (juce::uint16 newChannelMask) { mChannelMask.store (newChannelMask); }
+
+        // Combination of MidiThruType
+        void setTypeMask (int newTypeMask) { mTypeMask.store (newTypeMask & ThruAllTypes); }
+
+        auto isEnabled() const { return mEnabled.load(); }
+
+        // Audio thread, start of processBlock. The host's buffer is empty afterwards.
+        void takeInput (juce::MidiBuffer& hostBuffer)
+        {
+            mInput.clear();
+            mInput.swapWith (hostBuffer);
+        }
+
+        // Audio thread, end of processBlock
+        void mergeInto (juce::MidiBuffer& hostBuffer)
+        {
+            if (mEnabled.load())
+            {
+                const auto channelMask = mChannelMask.load();
+                const auto typeMask = mTypeMask.load();
+
+                for (const auto metadata : mInput)
+                {
+                    if (accepts (metadata.data, metadata.numBytes, channelMask, typeMask))
+                    {
+                        hostBuffer.addEvent (metadata.data, metadata.numBytes, metadata.samplePosition);
+                    }
+                }
+            }
+
+            mInput.clear();
+        }
+
+        static bool accepts (const juce::uint8* data, int numBytes, juce::uint16 channelMask, int typeMask)
+        {
+            if (numBytes < 1 || data[0] < 0x80)
+            {
+                return false;
+            }
+
+            const auto status = data[0];
+
+            if (status >= 0xf0)
+            {
+                return (typeMask & ThruSystem) != 0;
+            }
+
+            // Indexed by the status nibble 0x8 - 0xe
+            static constexpr std::array<int, 7> typeOfStatus { ThruNotes, ThruNotes, ThruPolyPressure, ThruControllers, ThruProgramChange, ThruChannelPressure, ThruPitchBend };
+            const auto type = typeOfStatus[static_cast<std::size_t> ((status >> 4) & 7)];
+
+            return (typeMask & type) != 0 && (channelMask & (1 << (status & 0x0f))) != 0;
+        }
+
+    private:
+        juce::MidiBuffer mInput;
+
+        std::atomic<bool> mEnabled { true };
+        std::atomic<juce::uint16> mChannelMask { allChannels };
+        std::atomic<int> mTypeMask { ThruAllTypes };
+    };
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "MidiEvent.h"
+#include "TimerWheel.h"
+#include <array>
+#include <juce_core/juce_core.h>
+
+namespace birdhouse
+{
+    /**
+     * @class NoteOffScheduler
+     * @brief Sends note offs a fixed time after the note ons of channels that have a note length set
+     *
+     * Sensors that only ever send triggers never send the 0 that would release a note. The note offs wait in a timer
+     * wheel that is advanced once per block, so each one lands on the exact sample it is due. A note that is played
+     * again or released before its timer fires invalidates the timer. Audio thread only.
+     */
+    class NoteOffScheduler
+    {
+    public:
+        // Notes still sounding keep their note offs, due after the same time at the new sample rate
+        void prepare (double sampleRate)
+        {
+            if (sampleRate != mSampleRate)
+            {
+                mWheel.rescale (sampleRate / mSampleRate);
+                mSampleRate = sampleRate;
+            }
+        }
+
+        // Call for every MIDI message written to the host at sampleOffset in the current block, before advance()
+        void handleWrittenMessage (int bridgeChannel, const juce::uint8* bytes, int numBytes, int sampleOffset, float noteLengthMs)
+        {
+            if (numBytes < 3)
+            {
+                return;
+            }
+
+            const auto type = bytes[0] & 0xf0;
+            const auto midiChannel = (bytes[0] & 0x0f) + 1;
+            const auto note = static_cast<int> (bytes[1]);
+
+            if (type != 0x80 && type != 0x90)
+            {
+                return;
+            }
+
+            const auto serial = ++serialFor (midiChannel, note);
+
+            if (type == 0x90 && bytes[2] > 0 && noteLengthMs > 0.f)
+            {
+                const auto delay = sampleOffset + juce::roundToInt (static_cast<double> (noteLengthMs) * 0.001 * mSampleRate);
+
+                if (!mWheel.schedule (delay, { MidiEvent::noteOff (midiChannel, note), serial, bridgeChannel }))
+                {
+                    DBG ("NoteOffScheduler: too many pending note offs, dropped one");
+                }
+            }
+        }
+
+        // Moves on by one block, calling onNoteOff (int bridgeChannel, const MidiEvent& noteOff, int sampleOffset)
+        template <typename NoteOffCallback>
+        void advance (int numSamples, NoteOffCallback&& onNoteOff)
+        {
+            mWheel.advance (numSamples, [&] (const PendingNoteOff& pending, int sampleOffset) {
+                if (pending.serial == serialFor (pending.noteOff.channel(), pending.noteOff.data1()))
+                {
+                    onNoteOff (pending.bridgeChannel, pending.noteOff, sampleOffset);
+                }
+            });
+        }
+
+        auto getNumPending() const { return mWheel.getNumScheduled(); }
+
+    private:
+        struct PendingNoteOff
+        {
+            MidiEvent noteOff;
+            juce::uint32 serial { 0 };
+            int bridgeChannel { 0 };
+        };
+
+        juce::uint32& serialFor (int midiChannel, int note)
+        {
+            return mSerials[static_cast<std::size_t> (((midiChannel - 1) & 0x0f) * 128 + (note & 0x7f))];
+        }
+
+        TimerWheel<PendingNoteOff> mWheel;
+        std::array<juce::uint32, 16 * 128> mSerials {};
+        double mSampleRate { 44100.0 };
+    };
+}
@@ -1,8 +1,23 @@
 #pragma once
 
+#include "ActiveNoteTracker.h"
+#include "ControllerGlide.h"
+#include "DirectMidiOutput.h"
+#include "EventFifo.h"
+#include "HighResolutionMidiEncoder.h"
+#include "MPEZone.h"
+#include "MappingExpression.h"
+#include "MidiEvent.h"
+#include "ResponseCurve.h"
+#include "UniversalMidiPacket.h"
+#include "ValueSmoother.h"
+#include <array>
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_data_structures/juce_data_structures.h>
 #include <juce_osc/juce_osc.h>
+#include <optional>
+#include <utility>
+#include <vector>
 
 namespace birdhouse
 {
@@ -10,40 +25,103 @@ namespace birdhouse
         MidiCC,
         MidiNote,
         MidiBend,
+        MidiCC14,
+        MidiNRPN,
+        MidiRPN,
+        MidiMPE,
+        MidiPolyPressure,
+        MidiChannelPressure,
+        MidiProgramChange,
         NumMsgTypes
     };
 
     /**
      * @class MidiMessageConverter
-     * @brief Converts a normalized value to a MIDI message
+     * @brief Converts a normalized value to a MIDI event
      *
+     * Only the message types that map one value to one event are handled here. The conversion is picked at compile
+     * time, see OSCBridgeChannel::convertAndAddMidi.
      */
     class MidiMessageConverter
     {
     public:
-        static juce::MidiMessage floatToMidiMessage (float normalizedValue, int outputMidiChannel, int outputNum, MsgType msgType)
+        template <MsgType Type>
+        static MidiEvent toMidiEvent (float normalizedValue, int outputMidiChannel, int outputNum)
         {
-            juce::MidiMessage midiMessage;
+            if constexpr (Type == MsgType::MidiNote)
+            {
+                const auto velocity = static_cast<uint8_t> (normalizedValue * 127.f);
+                return (normalizedValue == 0.f) ? MidiEvent::noteOff (outputMidiChannel, outputNum, velocity)
+                                                : MidiEvent::noteOn (outputMidiChannel, outputNum, velocity);
+            }
+            else if constexpr (Type == MsgType::MidiCC)
+            {
+                return MidiEvent::controller (outputMidiChannel, outputNum, static_cast<uint8_t> (normalizedValue * 127.f));
+            }
+            else if constexpr (Type == MsgType::MidiBend)
+            {
+                juce::ignoreUnused (outputNum);
+                return MidiEvent::pitchBend (outputMidiChannel, juce::jlimit (0, 16383, static_cast<int> (normalizedValue * 16383)));
+            }
+            else if constexpr (Type == MsgType::MidiPolyPressure)
+            {
+                return MidiEvent::polyPressure (outputMidiChannel, outputNum, static_cast<uint8_t> (normalizedValue * 127.f));
+            }
+            else if constexpr (Type == MsgType::MidiChannelPressure)
+            {
+                juce::ignoreUnused (outputNum);
+                return MidiEvent::channelPressure (outputMidiChannel, static_cast<uint8_t> (normalizedValue * 127.f));
+            }
+            else if constexpr (Type == MsgType::MidiProgramChange)
+            {
+                juce::ignoreUnused (outputNum);
+                return MidiEvent::programChange (outputMidiChannel, static_cast<uint8_t> (normalizedValue * 127.f));
+            }
+            else
+            {
+                static_assert (Type == MsgType::MidiCC, "Multi message types are encoded by HighResolutionMidiEncoder or MPEZone");
+                return {};
+            }
+        }
 
-            switch (msgType)
+        // The other way round, for OSCReverseBridge: the normalized value of an event if it matches the mapping.
+        // Only the types that map one value to one event can be reversed.
+        static std::optional<float> toNormalizedValue (const MidiEvent& event, MsgType type, int midiChannel, int number)
+        {
+            if (event.isEmpty() || event.channel() != midiChannel)
+            {
+                return std::nullopt;
+            }
+
+            const auto status = event.status() & 0xf0;
+            const auto matchesNumber = event.data1() == number;
+
+            switch (type)
             {
-                case MsgType::MidiNote:
-                    midiMessage = (normalizedValue == 0.f) ? juce::MidiMessage::noteOff (outputMidiChannel, outputNum, static_cast<uint8_t> (normalizedValue * 127.f))
-                                                           : juce::MidiMessage::noteOn (outputMidiChannel, outputNum, static_cast<uint8_t> (normalizedValue * 127.f));
-                    break;
                 case MsgType::MidiCC:
-                    midiMessage = juce::MidiMessage::controllerEvent (outputMidiChannel, outputNum, static_cast<uint8_t> (normalizedValue * 127.f));
-                    break;
+                    return status == 0xb0 && matchesNumber ? std::optional<float> (event.data2() / 127.f) : std::nullopt;
+                case MsgType::MidiNote:
+                    if (status == 0x80 && matchesNumber)
+                    {
+                        return 0.f;
+                    }
+                    return status == 0x90 && matchesNumber ? std::optional<float> (event.data2() / 127.f) : std::nullopt;
                 case MsgType::MidiBend:
-                    midiMessage = juce::MidiMessage::pitchWheel (outputMidiChannel, static_cast<int> (normalizedValue * 16383) - 8192);
-                    break;
+                    return status == 0xe0 ? std::optional<float> (static_cast<float> (event.data1() | (event.data2() << 7)) / 16383.f) : std::nullopt;
+                case MsgType::MidiPolyPressure:
+                    return status == 0xa0 && matchesNumber ? std::optional<float> (event.data2() / 127.f) : std::nullopt;
+                case MsgType::MidiChannelPressure:
+                    return status == 0xd0 ? std::optional<float> (event.data1() / 127.f) : std::nullopt;
+                case MsgType::MidiProgramChange:
+                    return status == 0xc0 ? std::optional<float> (event.data1() / 127.f) : std::nullopt;
+                case MsgType::MidiCC14:
+                case MsgType::MidiNRPN:
+                case MsgType::MidiRPN:
+                case MsgType::MidiMPE:
                 case MsgType::NumMsgTypes:
-                    break;
                 default:
-                    break;
+                    return std::nullopt;
             }
-
-            return midiMessage;
         }
     };
 
@@ -96,42 +174,154 @@ namespace birdhouse
 
     /**
      * @class BridgeMidiBufferManager
-     * @brief Manages a buffer of MIDI messages
+     * @brief Queues MIDI events from the OSC thread for the audio thread
      *
      */
     class BridgeMidiBufferManager
     {
     public:
-        BridgeMidiBufferManager()
+        // This is called by the OSC part of the plugin
+        void addMidiEvent (const MidiEvent& event)
         {
-            mInternalBuffer.clear();
+            if (auto* directOutput = mDirectOutput.load (std::memory_order_relaxed))
+            {
+                directOutput->send (event);
+                return;
+            }
+
+            // Notes and program changes have a queue of their own, so a flood of controllers can't fill it up or
+            // hold them back
+            auto& lane = isPriorityEvent (event) ? mPriorityEvents : mEvents;
+
+            if (!lane.push (event))
+            {
+                DBG ("BridgeMidiBufferManager: queue full, dropped a MIDI event");
+            }
         }
 
-        // This is called by the OSC part of the plugin
-        void addMidiMessage (const juce::MidiMessage& message, int timeStamp = 0)
+        static bool isPriorityEvent (const MidiEvent& event)
         {
-            DBG ("Adding MIDI message to buffer");
-            DBG ("Message: " + message.getDescription());
-            // FIXME: Without this lock, bad memory access segfaults will happen because the OSC thread is running realtime and writing to the midi buffer
-            const juce::ScopedLock lock (mCriticalSection); // Lock while reading/modifying
-            mInternalBuffer.addEvent (message, timeStamp);
+            const auto type = event.status() & 0xf0;
+            return type == 0x80 || type == 0x90 || type == 0xc0;
         }
 
-        // This is called at the start of each processBlock to move messages to the processBlock's midi buffer
-        void appendMessagesTo (juce::MidiBuffer& processBlockBuffer, int sampleNum = 0)
+        // This is called from processBlock to write the queued events into the host's midi buffer, notes and program
+        // changes first.
+        // onWritten (const juce::uint8* bytes, int numBytes, int sampleOffset) sees every message that was written.
+        // admit (const juce::uint8* bytes, int numBytes) can hold a message back by returning false (see MidiRateLimiter).
+        template <typename WrittenCallback, typename AdmitCallback>
+        void appendMessagesTo (juce::MidiBuffer& processBlockBuffer, int sampleNum, WrittenCallback&& onWritten, AdmitCallback&& admit)
+        {
+            appendPriorityMessagesTo (processBlockBuffer, sampleNum, onWritten);
+            appendControllerMessagesTo (processBlockBuffer, sampleNum, onWritten, admit, [] { return false; });
+        }
+
+        // The notes and program changes only, see appendMessagesTo
+        template <typename WrittenCallback>
+        void appendPriorityMessagesTo (juce::MidiBuffer& processBlockBuffer, int sampleNum, WrittenCallback&& onWritten)
+        {
+            mPriorityEvents.popAll ([&] (const MidiEvent* events, int numEvents) {
+                for (auto i = 0; i < numEvents; ++i)
+                {
+                    writeEvent (processBlockBuffer, events[i], sampleNum, onWritten);
+                }
+            });
+        }
+
+        // Everything else, see appendMessagesTo. Once coalesce() returns true, only the latest of the remaining
+        // messages is written, which is only safe for channels that send a single message per value.
+        template <typename WrittenCallback, typename AdmitCallback, typename CoalesceCallback>
+        void appendControllerMessagesTo (juce::MidiBuffer& processBlockBuffer, int sampleNum, WrittenCallback&& onWritten, AdmitCallback&& admit, CoalesceCallback&& coalesce)
         {
-            // FIXME: Without this lock, bad memory access segfaults will happen because the OSC thread is running realtime and writing to the midi buffer
-            const juce::ScopedLock lock (mCriticalSection); // Lock while reading/modifying
-            processBlockBuffer.addEvents (mInternalBuffer, 0, -1, sampleNum);
+            MidiEvent latest;
 
-            mInternalBuffer.clear();
+            mEvents.popAll ([&] (const MidiEvent* events, int numEvents) {
+                for (auto i = 0; i < numEvents; ++i)
+                {
+                    if (!latest.isEmpty() || coalesce())
+                    {
+                        latest = events[i];
+                    }
+                    else if (admit (events[i].bytes.data(), static_cast<int> (events[i].numBytes)))
+                    {
+                        writeEvent (processBlockBuffer, events[i], sampleNum, onWritten);
+                    }
+                }
+            });
+
+            if (!latest.isEmpty() && admit (latest.bytes.data(), static_cast<int> (latest.numBytes)))
+            {
+                writeEvent (processBlockBuffer, latest, sampleNum, onWritten);
+            }
+        }
+
+        template <typename WrittenCallback>
+        void appendMessagesTo (juce::MidiBuffer& processBlockBuffer, int sampleNum, WrittenCallback&& onWritten)
+        {
+            appendMessagesTo (processBlockBuffer, sampleNum, onWritten, admitAll);
         }
 
+        void appendMessagesTo (juce::MidiBuffer& processBlockBuffer, int sampleNum = 0)
+        {
+            appendMessagesTo (processBlockBuffer, sampleNum, [] (const juce::uint8*, int, int) {});
+        }
+
+        auto isNoteActive (int midiChannel, int note) const { return mActiveNotes.isActive (midiChannel, note); }
+
+        // A note off for this channel's note was sent from elsewhere (see NoteOffScheduler)
+        void noteReleased (int midiChannel, int note) { mActiveNotes.noteOff (midiChannel, note); }
+
+        // Events skip the queue and processBlock and go straight out of this port. nullptr goes back to the queue.
+        // Set through OSCBridgeManager::setDirectMidiOutput, so it never changes in the middle of a dispatch.
+        void setDirectMidiOutput (DirectMidiOutput* output) { mDirectOutput.store (output); }
+        auto hasDirectMidiOutput() const { return mDirectOutput.load() != nullptr; }
+
+    protected:
+        static constexpr auto admitAll = [] (const juce::uint8*, int) { return true; };
+
+        // Notes that went to the host and have not been released yet
+        ActiveNoteTracker mActiveNotes;
+
     private:
-        // FIXME: Temporary
-        juce::CriticalSection mCriticalSection; // Replaces std::mutex
+        template <typename WrittenCallback>
+        void writeEvent (juce::MidiBuffer& processBlockBuffer, const MidiEvent& event, int sampleNum, WrittenCallback&& onWritten)
+        {
+            const auto sampleOffset = sampleNum + event.sampleOffset;
+            processBlockBuffer.addEvent (event.bytes.data(), event.numBytes, sampleOffset);
+            mActiveNotes.handleMessage (event.bytes.data(), event.numBytes);
+            onWritten (event.bytes.data(), static_cast<int> (event.numBytes), sampleOffset);
+        }
 
-        juce::MidiBuffer mInternalBuffer {};
+        EventFifo<MidiEvent> mPriorityEvents;
+        EventFifo<MidiEvent> mEvents;
+        std::atomic<DirectMidiOutput*> mDirectOutput { nullptr };
+    };
+
+    // What a channel listens to and what it sends, as stored in a Scene
+    struct ChannelMapping
+    {
+        juce::String path;
+        float inMin { 0.f }, inMax { 1.f };
+        int outChan { 1 }, outNum { 48 };
+        MsgType type { MsgType::MidiCC };
+        bool muted { false };
+
+        // The raw value when the scene was stored, for SceneMorph
+        float value { 0.f };
+    };
+
+    // The mappings of all channels, in channel order. Never changed once it is in use (see SceneBank).
+    struct Scene
+    {
+        std::vector<ChannelMapping> channels;
+    };
+
+    // The scene the channels read their mapping from. Readers register while they hold it, so SceneBank can delete a
+    // scene it replaced as soon as the last of them is gone.
+    struct ActiveScene
+    {
+        std::atomic<const Scene*> scene { nullptr };
+        mutable std::atomic<int> numReaders { 0 };
     };
 
     /**
@@ -167,8 +357,15 @@ namespace birdhouse
             mInputMax = newFromMax;
         }
 
+        // The mapping setters only flag a change if the value actually differs, so rewriting all channels from the
+        // parameters does not release notes on channels that did not change
         void setOutputMidiChannel (int newOutputMidiChannel)
         {
+            if (newOutputMidiChannel == mOutputMidiChan)
+            {
+                return;
+            }
+
             DBG ("Changing output MIDI channel from " + juce::String (mOutputMidiChan) + " to " + juce::String (newOutputMidiChannel) + " for path " + mPath);
             mMidiChanged.store (true);
             mOutputMidiChan = newOutputMidiChannel;
@@ -176,6 +373,11 @@ namespace birdhouse
 
         void setOutputMidiNum (int newOutputNum)
         {
+            if (newOutputNum == mOutMidiNum)
+            {
+                return;
+            }
+
             DBG ("Changing output MIDI number from " + juce::String (mOutMidiNum) + " to " + juce::String (newOutputNum) + " for path " + mPath);
             mMidiChanged.store (true);
             mOutMidiNum = newOutputNum;
@@ -183,11 +385,72 @@ namespace birdhouse
 
         void setOutputType (MsgType newOutputType)
         {
+            if (newOutputType == mMsgType)
+            {
+                return;
+            }
+
             DBG ("Changing output type from " + juce::String (mMsgType) + " to " + juce::String (newOutputType) + " for path " + mPath);
             mMidiChanged.store (true);
             mMsgType = newOutputType;
         }
 
+        // Encode as MIDI 2.0 packets with 32 bit resolution instead of MIDI 1.0 messages
+        void setMidi2Output (bool shouldUseMidi2)
+        {
+            DBG ("Changing MIDI 2.0 output from " + juce::String (static_cast<int> (mMidi2Output.load())) + " to " + juce::String (static_cast<int> (shouldUseMidi2)) + " for path " + mPath);
+            mMidi2Output.store (shouldUseMidi2);
+        }
+
+        // Note length in milliseconds for MidiNote, after which a note off is sent automatically. 0 waits for a 0 value.
+        void setNoteLength (float newNoteLengthMs)
+        {
+            mNoteLengthMs.store (juce::jmax (0.f, newNoteLengthMs));
+        }
+
+        // Glide time in milliseconds for CC and Bend, spread over the blocks by processBlock. 0 sends every value as is.
+        void setGlideTime (float newGlideMs)
+        {
+            mGlideMs.store (juce::jmax (0.f, newGlideMs));
+        }
+
+        // Reshapes the normalized value, see ResponseCurve. The lookup table is only rebuilt if the curve changed.
+        void setResponseCurve (CurveType newType, float amount, const juce::String& points)
+        {
+            mCurve.set (newType, amount, points);
+        }
+
+        // A formula applied to the normalized value before it's converted to MIDI, see MappingExpression
+        void setExpression (const juce::String& newExpression)
+        {
+            mExpression.set (newExpression);
+        }
+
+        inline auto applyExpression (float normalized, float normalizedSecond) const { return mExpression.evaluate (normalized, normalizedSecond); }
+
+        // Smoothing of the incoming values, see ValueSmoother. Not applied to notes and gliding channels.
+        void setSmoothingMode (SmoothingMode newMode)
+        {
+            mSmoothingMode.store (newMode);
+        }
+
+        void setSmoothingTime (float newSmoothingMs)
+        {
+            mSmoothingMs.store (juce::jmax (0.f, newSmoothingMs));
+        }
+
+        // Also render the value as a control signal on the audio output with the channel's number (see ControlSignalOutput)
+        void setControlSignalOutput (bool shouldOutputControlSignal)
+        {
+            mControlSignalOutput.store (shouldOutputControlSignal);
+        }
+
+        // Also write the value to the channel's host parameter, Value1 - Value8 (see HostParameterOutput)
+        void setAutomationOutput (bool shouldOutputAutomation)
+        {
+            mAutomationOutput.store (shouldOutputAutomation);
+        }
+
         void setMuted (bool shouldBeMuted)
         {
             DBG ("Changing muted from " + juce::String (static_cast<int> (mMuted)) + " to " + juce::String (static_cast<int> (shouldBeMuted)) + " for path " + mPath);
@@ -203,44 +466,128 @@ namespace birdhouse
 
         inline auto normalizeValue (float rawValue) -> auto
         {
-            return juce::jmap (rawValue, mInputMin.load(), mInputMax.load(), 0.0f, 1.0f);
+            return normalizeValue (rawValue, inMin(), inMax());
+        }
+
+        // With a range other than the channel's, e.g. one being morphed
+        inline float normalizeValue (float rawValue, float fromMin, float fromMax) const
+        {
+            return mCurve.apply (juce::jmap (rawValue, fromMin, fromMax, 0.0f, 1.0f));
         }
 
         inline auto getNormalizedValue() { return normalizeValue (mRawValue.load()); }
 
+        // While a scene is active, the mapping getters return the scene's mapping instead of the channel's own
+        void setSceneSource (const ActiveScene* activeScene, int channelIndex)
+        {
+            mActiveScene = activeScene;
+            mSceneIndex = static_cast<std::size_t> (channelIndex);
+        }
+
         auto muted() const
         {
-            return mMuted;
+            return fromScene ([] (const ChannelMapping& mapping) { return mapping.muted; }, mMuted);
         }
 
-        auto inMin() const
+        // While a SceneMorph runs, its ranges take over from the scene's and the channel's own
+        void setMorphedRange (float newMin, float newMax)
         {
-            return mInputMin.load();
+            mMorphedMin.store (newMin, std::memory_order_relaxed);
+            mMorphedMax.store (newMax, std::memory_order_relaxed);
+            mMorphing.store (true, std::memory_order_release);
         }
 
-        auto inMax() const
+        void clearMorphedRange() { mMorphing.store (false); }
+
+        float inMin() const
         {
-            return mInputMax.load();
+            if (mMorphing.load (std::memory_order_acquire))
+            {
+                return mMorphedMin.load (std::memory_order_relaxed);
+            }
+
+            return fromScene ([] (const ChannelMapping& mapping) { return mapping.inMin; }, mInputMin.load());
+        }
+
+        float inMax() const
+        {
+            if (mMorphing.load (std::memory_order_acquire))
+            {
+                return mMorphedMax.load (std::memory_order_relaxed);
+            }
+
+            return fromScene ([] (const ChannelMapping& mapping) { return mapping.inMax; }, mInputMax.load());
         }
 
         auto outChan() const
         {
-            return mOutputMidiChan;
+            return fromScene ([] (const ChannelMapping& mapping) { return mapping.outChan; }, mOutputMidiChan);
         }
 
         auto outNum() const
         {
-            return mOutMidiNum;
+            return fromScene ([] (const ChannelMapping& mapping) { return mapping.outNum; }, mOutMidiNum);
         }
 
         auto outType() const
         {
-            return mMsgType;
+            return fromScene ([] (const ChannelMapping& mapping) { return mapping.type; }, mMsgType);
+        }
+
+        // The channel's own mapping, whatever scene is active, for storing it in a scene
+        auto liveMapping() const
+        {
+            return ChannelMapping { mPath, mInputMin.load(), mInputMax.load(), mOutputMidiChan, mOutMidiNum, mMsgType, mMuted, mRawValue.load() };
+        }
+
+        auto midi2Output() const
+        {
+            return mMidi2Output.load();
+        }
+
+        auto noteLength() const
+        {
+            return mNoteLengthMs.load();
+        }
+
+        auto glideTime() const
+        {
+            return mGlideMs.load();
+        }
+
+        auto curveType() const
+        {
+            return mCurve.type();
+        }
+
+        auto usesSecondArgument() const
+        {
+            return mExpression.usesSecondArgument();
+        }
+
+        auto smoothingMode() const
+        {
+            return mSmoothingMode.load();
+        }
+
+        auto smoothingTime() const
+        {
+            return mSmoothingMs.load();
+        }
+
+        auto controlSignalOutput() const
+        {
+            return mControlSignalOutput.load();
+        }
+
+        auto automationOutput() const
+        {
+            return mAutomationOutput.load();
         }
 
         auto path() const
         {
-            return mPath;
+            return fromScene ([] (const ChannelMapping& mapping) { return mapping.path; }, mPath);
         }
 
         inline auto midiChanged() const { return mMidiChanged.load(); }
@@ -250,14 +597,47 @@ namespace birdhouse
             mMidiChanged.store (false);
         }
 
+        // Reads and clears the flag in one go, so a change that happens in between is not lost
+        auto consumeMidiChanged() { return mMidiChanged.exchange (false); }
+
     private:
+        // A field of the active scene's mapping for this channel, or the fallback without a scene
+        template <typename Getter, typename T>
+        T fromScene (Getter&& get, T fallback) const
+        {
+            if (mActiveScene == nullptr)
+            {
+                return fallback;
+            }
+
+            mActiveScene->numReaders.fetch_add (1);
+            const auto* scene = mActiveScene->scene.load();
+            auto value = scene != nullptr && mSceneIndex < scene->channels.size() ? T (get (scene->channels[mSceneIndex])) : std::move (fallback);
+            mActiveScene->numReaders.fetch_sub (1);
+
+            return value;
+        }
+
         juce::String mPath { "" };
         std::atomic<bool> mMidiChanged { false };
+        std::atomic<bool> mMidi2Output { false };
+        std::atomic<bool> mControlSignalOutput { false };
+        std::atomic<bool> mAutomationOutput { false };
+        std::atomic<float> mNoteLengthMs { 0.f };
+        std::atomic<float> mGlideMs { 0.f };
+        std::atomic<SmoothingMode> mSmoothingMode { SmoothingOff };
+        std::atomic<float> mSmoothingMs { 50.f };
         std::atomic<float> mInputMin { 0.f }, mInputMax { 1.0f };
+        std::atomic<float> mMorphedMin { 0.f }, mMorphedMax { 1.0f };
+        std::atomic<bool> mMorphing { false };
         std::atomic<float> mRawValue { 0.f };
+        ResponseCurve mCurve;
+        MappingExpression mExpression;
         int mOutputMidiChan { 1 }, mOutMidiNum { 48 };
         MsgType mMsgType { MsgType::MidiCC };
         bool mMuted { false };
+        const ActiveScene* mActiveScene { nullptr };
+        std::size_t mSceneIndex { 0 };
     };
 
     class OSCBridgeChannel : public BridgeOSCMessageReceiver, public BridgeMidiBufferManager
@@ -270,14 +650,42 @@ namespace birdhouse
             // Register callback that will be called when an OSC message is received
             this->addOSCCallback (
                 [this] (float rawValue, bool messageAccepted, const juce::OSCMessage& oscMessage) {
-                    juce::ignoreUnused (oscMessage);
+                    if (mState.outType() == MsgType::MidiMPE)
+                    {
+                        if (!mState.muted())
+                        {
+                            handleTouchMessage (oscMessage);
+                        }
+
+                        return;
+                    }
+
+                    // Only an expression that uses y takes a second argument
+                    auto normalizedSecond = 0.f;
+                    if (!messageAccepted && mState.usesSecondArgument() && hasTwoNumericArguments (oscMessage))
+                    {
+                        rawValue = argumentAsFloat (oscMessage[0]);
+                        normalizedSecond = mState.normalizeValue (argumentAsFloat (oscMessage[1]));
+                        messageAccepted = true;
+                    }
+
                     mState.setRawValue (rawValue);
 
-                    if (!mState.muted() && messageAccepted)
+                    if (!messageAccepted)
                     {
-                        auto normalized = mState.getNormalizedValue();
-                        auto midiMessage = MidiMessageConverter::floatToMidiMessage (normalized, mState.outChan(), mState.outNum(), mState.outType());
-                        this->addMidiMessage (midiMessage);
+                        return;
+                    }
+
+                    // Gliding channels are written by processBlock, towards the value after the expression
+                    const auto value = mState.applyExpression (mState.getNormalizedValue(), normalizedSecond);
+                    mGlideTarget.store (value);
+
+                    const auto output = usesGlide() ? value : smooth (value);
+                    mOutputValue.store (output);
+
+                    if (!mState.muted() && !usesGlide())
+                    {
+                        convertAndAddMidi (output);
                     }
                 });
 
@@ -286,13 +694,447 @@ namespace birdhouse
 
         auto& state() { return mState; }
 
+        // The value the channel turns into MIDI, after the curve, expression and smoothing. The CV and automation
+        // outputs follow this, so they match the MIDI.
+        auto getOutputValue() const { return mOutputValue.load(); }
+
+        // MPE channels take every touch below their path, e.g. /touch/0, /touch/1 for the path /touch
         auto matchesPath (const juce::String& address) const
         {
+            if (mState.outType() == MsgType::MidiMPE)
+            {
+                return touchIdFromAddress (address) >= 0;
+            }
+
             return address == mState.path();
         }
 
+        // Called from processBlock. Writes the expression and notes of every touch that changed since the last block.
+        template <typename WrittenCallback>
+        void appendMPETo (juce::MidiBuffer& processBlockBuffer, int sampleNum, WrittenCallback&& onWritten)
+        {
+            // Voices still sounding after switching away from MPE get their note offs all the same
+            if (hasDirectMidiOutput() || (mState.outType() != MsgType::MidiMPE && mMPEZone.getNumActiveVoices() == 0))
+            {
+                return;
+            }
+
+            mMPEZone.render ([&] (const MidiEvent& event) {
+                processBlockBuffer.addEvent (event.bytes.data(), event.numBytes, sampleNum);
+                mActiveNotes.handleMessage (event.bytes.data(), event.numBytes);
+                onWritten (event.bytes.data(), static_cast<int> (event.numBytes), sampleNum);
+            });
+        }
+
+        void appendMPETo (juce::MidiBuffer& processBlockBuffer, int sampleNum = 0)
+        {
+            appendMPETo (processBlockBuffer, sampleNum, [] (const juce::uint8*, int, int) {});
+        }
+
+        // Message thread, before listening. All MPE channels of the bridge take their member channels from one pool.
+        void setMPEVoicePool (std::shared_ptr<MPEVoicePool> pool)
+        {
+            mMPEZone.setVoicePool (std::move (pool));
+        }
+
+        // Called from prepareToPlay
+        void prepare (double sampleRate)
+        {
+            mGlide.prepare (sampleRate);
+        }
+
+        // MIDI 2.0 and the direct output have no block to spread a glide over
+        bool usesGlide() const
+        {
+            const auto type = mState.outType();
+            return mState.glideTime() > 0.f && (type == MsgType::MidiCC || type == MsgType::MidiBend) && !mState.midi2Output() && !hasDirectMidiOutput();
+        }
+
+        // Called from processBlock. Glides towards the latest value, at most maxEventsPerSecond steps.
+        template <typename WrittenCallback, typename AdmitCallback>
+        void appendGlideTo (juce::MidiBuffer& processBlockBuffer, int numSamples, float maxEventsPerSecond, WrittenCallback&& onWritten, AdmitCallback&& admit)
+        {
+            if (!usesGlide() || mState.muted())
+            {
+                mGlide.reset();
+                return;
+            }
+
+            const auto type = mState.outType();
+            const auto outChan = mState.outChan();
+            const auto outNum = mState.outNum();
+            const auto resolution = type == MsgType::MidiBend ? 16383 : 127;
+
+            mGlide.process (mGlideTarget.load(), mState.glideTime(), maxEventsPerSecond, resolution, numSamples, [&] (float value, int sampleOffset) {
+                const auto event = type == MsgType::MidiBend ? MidiMessageConverter::toMidiEvent<MsgType::MidiBend> (value, outChan, outNum)
+                                                             : MidiMessageConverter::toMidiEvent<MsgType::MidiCC> (value, outChan, outNum);
+
+                if (!admit (event.bytes.data(), static_cast<int> (event.numBytes)))
+                {
+                    return;
+                }
+
+                processBlockBuffer.addEvent (event.bytes.data(), event.numBytes, sampleOffset);
+                onWritten (event.bytes.data(), static_cast<int> (event.numBytes), sampleOffset);
+            });
+        }
+
+        template <typename WrittenCallback>
+        void appendGlideTo (juce::MidiBuffer& processBlockBuffer, int numSamples, float maxEventsPerSecond, WrittenCallback&& onWritten)
+        {
+            appendGlideTo (processBlockBuffer, numSamples, maxEventsPerSecond, onWritten, admitAll);
+        }
+
+        // Continuous controllers send one message per value, so a value in between can be skipped (see MidiRateLimiter)
+        bool isRateLimited() const
+        {
+            const auto type = mState.outType();
+            return type == MsgType::MidiCC || type == MsgType::MidiBend || type == MsgType::MidiPolyPressure || type == MsgType::MidiChannelPressure;
+        }
+
+        // Called from processBlock with a value from SceneMorph. Only the continuous types follow a morph, and only
+        // changes of the MIDI value are written.
+        template <typename WrittenCallback, typename AdmitCallback>
+        void appendMorphTo (juce::MidiBuffer& processBlockBuffer, float normalized, WrittenCallback&& onWritten, AdmitCallback&& admit)
+        {
+            if (!isRateLimited())
+            {
+                return;
+            }
+
+            // Like the MIDI, the CV and automation outputs follow the morph
+            mOutputValue.store (normalized);
+
+            if (mState.muted())
+            {
+                return;
+            }
+
+            const auto outChan = mState.outChan();
+            const auto outNum = mState.outNum();
+            MidiEvent event;
+
+            switch (mState.outType())
+            {
+                case MsgType::MidiBend:
+                    event = MidiMessageConverter::toMidiEvent<MsgType::MidiBend> (normalized, outChan, outNum);
+                    break;
+                case MsgType::MidiPolyPressure:
+                    event = MidiMessageConverter::toMidiEvent<MsgType::MidiPolyPressure> (normalized, outChan, outNum);
+                    break;
+                case MsgType::MidiChannelPressure:
+                    event = MidiMessageConverter::toMidiEvent<MsgType::MidiChannelPressure> (normalized, outChan, outNum);
+                    break;
+                case MsgType::MidiCC:
+                case MsgType::MidiNote:
+                case MsgType::MidiCC14:
+                case MsgType::MidiNRPN:
+                case MsgType::MidiRPN:
+                case MsgType::MidiMPE:
+                case MsgType::MidiProgramChange:
+                case MsgType::NumMsgTypes:
+                default:
+                    event = MidiMessageConverter::toMidiEvent<MsgType::MidiCC> (normalized, outChan, outNum);
+                    break;
+            }
+
+            if (event == mLastMorphEvent || !admit (event.bytes.data(), static_cast<int> (event.numBytes)))
+            {
+                return;
+            }
+
+            mLastMorphEvent = event;
+            processBlockBuffer.addEvent (event.bytes.data(), event.numBytes, 0);
+            onWritten (event.bytes.data(), static_cast<int> (event.numBytes), 0);
+        }
+
+        // Called from processBlock after the channel's events have been appended, if its mapping changed.
+        // Sends note offs for the notes this channel left sounding, except the one its current mapping would play.
+        void releaseStaleNotes (juce::MidiBuffer& processBlockBuffer, int sampleNum = 0)
+        {
+            // MPE voices give their member channels back as well, and the zone is announced again
+            mMPEZone.releaseAll ([&] (const MidiEvent& noteOff) {
+                processBlockBuffer.addEvent (noteOff.bytes.data(), noteOff.numBytes, sampleNum);
+                mActiveNotes.noteOff (noteOff.channel(), noteOff.data1());
+            });
+
+            const auto keepCurrentNote = mState.outType() == MsgType::MidiNote;
+            const auto currentChannel = mState.outChan();
+            const auto currentNote = mState.outNum();
+
+            mActiveNotes.forEachActiveNote ([&] (int midiChannel, int note) {
+                if (keepCurrentNote && midiChannel == currentChannel && note == currentNote)
+                {
+                    return;
+                }
+
+                const auto noteOff = MidiEvent::noteOff (midiChannel, note);
+                processBlockBuffer.addEvent (noteOff.bytes.data(), noteOff.numBytes, sampleNum);
+                mActiveNotes.noteOff (midiChannel, note);
+            });
+        }
+
+        // Called from processBlock. MIDI 2.0 packets from this channel are downconverted, since the host gets MIDI 1.0.
+        template <typename WrittenCallback, typename AdmitCallback>
+        void appendUMPAsMidi1To (juce::MidiBuffer& processBlockBuffer, int sampleNum, WrittenCallback&& onWritten, AdmitCallback&& admit)
+        {
+            mUMPOutput.popAll ([&] (const ump::Packet64* packets, int numPackets) {
+                mDownconverter.convert (packets, numPackets, [&] (const juce::uint8* bytes, int numBytes) {
+                    if (!admit (bytes, numBytes))
+                    {
+                        return;
+                    }
+
+                    processBlockBuffer.addEvent (bytes, numBytes, sampleNum);
+                    mActiveNotes.handleMessage (bytes, numBytes);
+                    onWritten (bytes, numBytes, sampleNum);
+                });
+            });
+        }
+
+        template <typename WrittenCallback>
+        void appendUMPAsMidi1To (juce::MidiBuffer& processBlockBuffer, int sampleNum, WrittenCallback&& onWritten)
+        {
+            appendUMPAsMidi1To (processBlockBuffer, sampleNum, onWritten, admitAll);
+        }
+
+        void appendUMPAsMidi1To (juce::MidiBuffer& processBlockBuffer, int sampleNum = 0)
+        {
+            appendUMPAsMidi1To (processBlockBuffer, sampleNum, [] (const juce::uint8*, int, int) {});
+        }
+
+        // Channels sending to the same output share this, so RPN/NRPN selects are not repeated needlessly
+        void setParameterSelection (std::shared_ptr<MidiParameterSelection> selection)
+        {
+            mParameterSelection = std::move (selection);
+        }
+
     private:
+        // The host only ever gets MIDI 1.0. These types already reach it at 14 bits, which one downconverted packet
+        // can't match: it would lose the LSB of CC 14-bit and repeat the RPN/NRPN select that the shared selection
+        // (see MidiParameterSelection) skips. So they are encoded as MIDI 1.0 in both protocols.
+        static constexpr bool isEncodedAsMidi1 (MsgType type)
+        {
+            return type == MsgType::MidiCC14 || type == MsgType::MidiNRPN || type == MsgType::MidiRPN;
+        }
+
+        static constexpr bool isDeduplicated (MsgType type)
+        {
+            return type == MsgType::MidiPolyPressure || type == MsgType::MidiChannelPressure || type == MsgType::MidiProgramChange;
+        }
+
+        // Returns the N of path/N, or -1 if the address is not a touch of this channel
+        int touchIdFromAddress (const juce::String& address) const
+        {
+            const auto& path = mState.path();
+
+            if (!address.startsWith (path) || address.length() <= path.length() + 1 || address[path.length()] != '/')
+            {
+                return -1;
+            }
+
+            const auto id = address.substring (path.length() + 1);
+            return id.containsOnly ("0123456789") ? id.getIntValue() : -1;
+        }
+
+        static float argumentAsFloat (const juce::OSCArgument& argument)
+        {
+            return argument.isInt32() ? static_cast<float> (argument.getInt32()) : argument.getFloat32();
+        }
+
+        static bool hasTwoNumericArguments (const juce::OSCMessage& message)
+        {
+            return message.size() == 2 && (message[0].isFloat32() || message[0].isInt32()) && (message[1].isFloat32() || message[1].isInt32());
+        }
+
+        // path/N x y z, each scaled by the channel's input range. z (pressure) of 0 ends the touch.
+        void handleTouchMessage (const juce::OSCMessage& message)
+        {
+            if (message.size() < 3)
+            {
+                return;
+            }
+
+            for (auto i = 0; i < 3; ++i)
+            {
+                if (!message[i].isFloat32() && !message[i].isInt32())
+                {
+                    return;
+                }
+            }
+
+            // MIDIChan 16 puts the channel in the upper zone, anything else in the lower one
+            mMPEZone.setZone (mState.outChan() == 16 ? MPEVoicePool::UpperZone : MPEVoicePool::LowerZone);
+            mMPEZone.touch (touchIdFromAddress (message.getAddressPattern().toString()),
+                mState.outNum(),
+                mState.normalizeValue (argumentAsFloat (message[0])),
+                mState.normalizeValue (argumentAsFloat (message[1])),
+                mState.normalizeValue (argumentAsFloat (message[2])));
+
+            // Without processBlock in the way, the touch goes out right away
+            if (hasDirectMidiOutput())
+            {
+                mMPEZone.render ([this] (const MidiEvent& event) { addMidiEvent (event); });
+            }
+        }
+
+        // Notes are left alone, a smoothed velocity would never get back to the 0 of a note off
+        float smooth (float normalized)
+        {
+            const auto mode = mState.smoothingMode();
+
+            if (mode == SmoothingOff || mState.outType() == MsgType::MidiNote)
+            {
+                mSmoother.reset();
+                return normalized;
+            }
+
+            return mSmoother.process (normalized, mode, mState.smoothingTime(), juce::Time::getMillisecondCounterHiRes());
+        }
+
+        template <MsgType Type>
+        void convertAndAdd (float normalized, int outChan, int outNum)
+        {
+            auto addEvent = [this] (const MidiEvent& event) { this->addMidiEvent (event); };
+
+            if constexpr (Type == MsgType::MidiCC14)
+            {
+                // Only controllers 0 - 31 have an LSB partner, the rest stay 7 bit
+                if (outNum < 32)
+                {
+                    mHighResolutionEncoder.encodeController (normalized, outChan, outNum, addEvent);
+                }
+                else
+                {
+                    addEvent (MidiMessageConverter::toMidiEvent<MsgType::MidiCC> (normalized, outChan, outNum));
+                }
+            }
+            else if constexpr (Type == MsgType::MidiNRPN || Type == MsgType::MidiRPN)
+            {
+                mHighResolutionEncoder.encodeParameter (normalized, outChan, outNum, Type == MsgType::MidiRPN, *mParameterSelection, addEvent);
+            }
+            else if constexpr (Type == MsgType::MidiMPE)
+            {
+                // Touches are handled by handleTouchMessage
+                juce::ignoreUnused (normalized, outChan, outNum);
+            }
+            else
+            {
+                // Like the high resolution types, an unchanged message is not sent again. For program changes this
+                // also keeps the receiver from reloading the same program. A smoothed value creeps towards its target
+                // in steps much finer than 7 bit, so there the same goes for CC and Bend.
+                const auto event = MidiMessageConverter::toMidiEvent<Type> (normalized, outChan, outNum);
+
+                if (isDeduplicated (Type) || (Type != MsgType::MidiNote && mState.smoothingMode() != SmoothingOff))
+                {
+                    if (event == mLastEvent)
+                    {
+                        return;
+                    }
+
+                    mLastEvent = event;
+                }
+
+                addEvent (event);
+            }
+        }
+
+        using ConvertFunction = void (OSCBridgeChannel::*) (float, int, int);
+
+        template <int... Types>
+        static constexpr std::array<ConvertFunction, sizeof...(Types)> makeConverterTable (std::integer_sequence<int, Types...>)
+        {
+            return { { &OSCBridgeChannel::convertAndAdd<static_cast<MsgType> (Types)>... } };
+        }
+
+        void convertAndAddMidi (float normalized)
+        {
+            // A direct output is a MIDI 1.0 port, so it gets MIDI 1.0 right away
+            if (mState.midi2Output() && !hasDirectMidiOutput() && !isEncodedAsMidi1 (mState.outType()))
+            {
+                convertAndAddUMP (normalized, mState.outChan(), mState.outNum());
+                return;
+            }
+
+            // One converter per MsgType, resolved at compile time
+            static constexpr auto converters = makeConverterTable (std::make_integer_sequence<int, NumMsgTypes> {});
+
+            const auto type = static_cast<int> (mState.outType());
+            if (type >= 0 && type < NumMsgTypes)
+            {
+                (this->*converters[static_cast<std::size_t> (type)]) (normalized, mState.outChan(), mState.outNum());
+            }
+        }
+
+        // Packed straight into UMP words, no juce::MidiMessage involved
+        void convertAndAddUMP (float normalized, int outChan, int outNum)
+        {
+            const auto value = ump::toUint32 (normalized);
+            ump::Packet64 packet;
+
+            switch (mState.outType())
+            {
+                case MsgType::MidiNote:
+                    packet = normalized == 0.f ? ump::makeNoteOff (outChan, outNum, 0)
+                                               : ump::makeNoteOn (outChan, outNum, static_cast<juce::uint16> (value >> 16));
+                    break;
+                case MsgType::MidiBend:
+                    packet = ump::makePitchBend (outChan, value);
+                    break;
+                case MsgType::MidiPolyPressure:
+                    packet = ump::makePolyPressure (outChan, outNum, value);
+                    break;
+                case MsgType::MidiChannelPressure:
+                    packet = ump::makeChannelPressure (outChan, value);
+                    break;
+                case MsgType::MidiProgramChange:
+                    packet = ump::makeProgramChange (outChan, static_cast<int> (normalized * 127.f));
+                    break;
+                case MsgType::MidiMPE:
+                case MsgType::MidiCC14:
+                case MsgType::MidiNRPN:
+                case MsgType::MidiRPN:
+                    // See isEncodedAsMidi1 and handleTouchMessage
+                    return;
+                case MsgType::MidiCC:
+                case MsgType::NumMsgTypes:
+                default:
+                    packet = ump::makeControlChange (outChan, outNum, value);
+                    break;
+            }
+
+            // Same deduplication as the MIDI 1.0 path, at the full MIDI 2.0 resolution
+            const auto deduplicate = isDeduplicated (mState.outType()) || (mState.outType() != MsgType::MidiNote && mState.smoothingMode() != SmoothingOff);
+            if (deduplicate && packet.word0 == mLastPacket.word0 && packet.word1 == mLastPacket.word1)
+            {
+                return;
+            }
+
+            mLastPacket = packet;
+
+            if (!mUMPOutput.push (packet))
+            {
+                DBG ("OSCBridgeChannel: UMP output full, dropped a packet for path " + mState.path());
+            }
+        }
+
         OSCBridgeChannelState mState;
+        HighResolutionMidiEncoder mHighResolutionEncoder;
+        ump::PacketFifo<> mUMPOutput;
+        ump::Midi1Downconverter mDownconverter;
+        MPEZone mMPEZone;
+        ControllerGlide mGlide;
+        std::atomic<float> mGlideTarget { 0.f };
+        std::atomic<float> mOutputValue { 0.f };
+        ValueSmoother mSmoother;
+
+        // Last message written for a morph, audio thread only
+        MidiEvent mLastMorphEvent;
+
+        // Last message of the deduplicated types, OSC thread only
+        MidiEvent mLastEvent;
+        ump::Packet64 mLastPacket;
+        std::shared_ptr<MidiParameterSelection> mParameterSelection { std::make_shared<MidiParameterSelection>() };
     };
 
 }
@@ -1,7 +1,14 @@
 #pragma once
 
 #include "OSCBridgeChannel.h"
+#include "OSCSharedMemoryReceiver.h"
+#include "OSCTCPReceiver.h"
+#include "OSCUDPReceiver.h"
+#include "OSCTransport.h"
+#include "OSCUnixSocketReceiver.h"
+#include <algorithm>
 #include <functional>
+#include <memory>
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_data_structures/juce_data_structures.h>
 #include <juce_osc/juce_osc.h>
@@ -12,7 +19,7 @@ namespace birdhouse
  * @brief The OSCBridgeManager class is responsible for managing the OSC bridge, it registers a callback for OSC and dispatches to all channels that are registered with it.
  *
  */
-    class OSCBridgeManager : private juce::OSCReceiver, private juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>
+    class OSCBridgeManager
     {
     public:
         using GlobalOSCCallback = std::function<void (const juce::OSCMessage&)>;
@@ -25,34 +32,136 @@ namespace birdhouse
 
                 // Add default callback
                 channel->addOSCCallback ([&] (auto normalizedValue, auto valueAccepted, auto rawOSCMessage) {
-                    juce::ignoreUnused (rawOSCMessage);
-                    juce::Logger::writeToLog ("Normalized value: " + juce::String (normalizedValue) + " Value accepted: " + juce::String (static_cast<int> (valueAccepted)) + " Raw OSC message: " + rawOSCMessage.getAddressPattern().toString());
+                    juce::ignoreUnused (normalizedValue, valueAccepted, rawOSCMessage);
+                    DBG ("Normalized value: " + juce::String (normalizedValue) + " Value accepted: " + juce::String (static_cast<int> (valueAccepted)) + " Raw OSC message: " + rawOSCMessage.getAddressPattern().toString());
                 });
             }
 
             addGlobalCallback ([&] (const juce::OSCMessage& message) {
-                juce::Logger::writeToLog ("Global callback: " + message.getAddressPattern().toString());
+                juce::ignoreUnused (message);
+                DBG ("Global callback: " + message.getAddressPattern().toString());
             });
-
-            mOscReceiver.addListener (this);
         }
 
-        ~OSCBridgeManager() override
+        ~OSCBridgeManager()
         {
             stopListening();
         }
 
+        // Construct a transport that delivers into this manager. It is started by the next startListening call.
+        template <typename TransportType>
+        TransportType& addTransport()
+        {
+            auto transport = std::make_unique<TransportType> ([this] (const juce::OSCMessage& message) { oscMessageReceived (message); });
+            auto& result = *transport;
+            mTransports.push_back (std::move (transport));
+            DBG ("OSC Bridge Manager: added transport " + result.getName());
+            return result;
+        }
+
+        // UDP on the port. TCP (SLIP framed OSC 1.1) on the port, a Unix domain socket and a shared memory ring named
+        // after it are added too, but stay disabled until they are switched on.
+        void addDefaultTransports()
+        {
+            addTransport<OSCUDPReceiver>();
+            addTransport<OSCTCPReceiver>().setEnabled (false);
+            addTransport<OSCUnixSocketReceiver>().setEnabled (false);
+            addTransport<OSCSharedMemoryReceiver>().setEnabled (false);
+        }
+
+        auto getTransports() const -> const std::vector<std::unique_ptr<OSCTransport>>&
+        {
+            return mTransports;
+        }
+
+        // The first transport of this type, or nullptr if there is none
+        template <typename TransportType>
+        TransportType* findTransport() const
+        {
+            for (auto& transport : mTransports)
+            {
+                if (auto* found = dynamic_cast<TransportType*> (transport.get()))
+                {
+                    return found;
+                }
+            }
+
+            return nullptr;
+        }
+
+        // Connects every enabled transport. Returns true only if all of them are listening, see getFailedTransports.
         bool startListening (int port)
         {
-            auto result = mOscReceiver.connect (port);
-            DBG ("OSC Bridge Manager: startListening:" + juce::String (static_cast<int> (result)) + " on port:" + juce::String (port));
+            auto result = true;
+
+            for (auto& transport : mTransports)
+            {
+                if (!transport->isEnabled())
+                {
+                    transport->disconnect();
+                    continue;
+                }
+
+                const auto connected = transport->connect (port);
+                DBG ("OSC Bridge Manager: startListening " + transport->getName() + ":" + juce::String (static_cast<int> (connected)) + " on port:" + juce::String (port));
+                result = result && connected;
+            }
+
             return result;
         }
 
+        // Names of the enabled transports that aren't listening, e.g. because another program has the port
+        juce::StringArray getFailedTransports() const
+        {
+            juce::StringArray failed;
+
+            for (auto& transport : mTransports)
+            {
+                if (transport->isEnabled() && !transport->isConnected())
+                {
+                    failed.add (transport->getName());
+                }
+            }
+
+            return failed;
+        }
+
         void stopListening()
         {
             DBG ("OSC Bridge Manager: stopListening");
-            mOscReceiver.disconnect();
+
+            for (auto& transport : mTransports)
+            {
+                transport->disconnect();
+            }
+        }
+
+        // Scheduling of the receive threads, applied the next time startListening is called
+        void setReceiveThreadOptions (const ReceiveThreadOptions& options)
+        {
+            for (auto& transport : mTransports)
+            {
+                transport->setThreadOptions (options);
+            }
+        }
+
+        bool isReceiveThreadRealtime() const
+        {
+            return std::any_of (mTransports.begin(), mTransports.end(), [] (auto& transport) { return transport->isRealtimeActive(); });
+        }
+
+        // How long packets wait before the receive thread gets to them, from the first transport that measures it
+        const ReceiveLatencyStats* getReceiveLatencyStats() const
+        {
+            for (auto& transport : mTransports)
+            {
+                if (auto* stats = transport->getLatencyStats())
+                {
+                    return stats;
+                }
+            }
+
+            return nullptr;
         }
 
         void registerChannel (std::shared_ptr<OSCBridgeChannel> channel)
@@ -60,6 +169,7 @@ namespace birdhouse
             DBG ("Registering channel with path: " + channel->state().path());
             if (channel)
             {
+                channel->setParameterSelection (mParameterSelection);
                 mChannels.emplace_back (channel);
             }
         }
@@ -71,6 +181,18 @@ namespace birdhouse
             DBG ("Num global callbacks:" + juce::String (mGlobalCallbacks.size()));
         }
 
+        // Sends the channels' MIDI straight to output from the dispatch, or back through processBlock for nullptr.
+        // Takes the dispatch lock, so once this returns nothing is sent to the previous output anymore.
+        void setDirectMidiOutput (DirectMidiOutput* output)
+        {
+            const juce::ScopedLock lock (mDispatchLock);
+
+            for (auto& channel : mChannels)
+            {
+                channel->setDirectMidiOutput (output);
+            }
+        }
+
         auto getChannels() const -> const std::vector<std::shared_ptr<OSCBridgeChannel>>&
         {
             return mChannels;
@@ -82,9 +204,13 @@ namespace birdhouse
         }
 
     protected:
-        void oscMessageReceived (const juce::OSCMessage& message) override
+        void oscMessageReceived (const juce::OSCMessage& message)
         {
             DBG ("Globally received OSC message:" + message.getAddressPattern().toString() + " with " + juce::String (message.size()) + " arguments");
+
+            // Messages may arrive from several transports, each with its own thread (or several, for TCP), at the same time
+            const juce::ScopedLock lock (mDispatchLock);
+
             for (auto& callback : mGlobalCallbacks)
             {
                 callback (message);
@@ -104,8 +230,12 @@ namespace birdhouse
         }
 
     private:
-        juce::OSCReceiver mOscReceiver;
+        juce::CriticalSection mDispatchLock;
         std::vector<std::shared_ptr<OSCBridgeChannel>> mChannels;
         std::vector<GlobalOSCCallback> mGlobalCallbacks {};
+        std::shared_ptr<MidiParameterSelection> mParameterSelection { std::make_shared<MidiParameterSelection>() };
+
+        // Declared last so the transports' threads are stopped before anything they dispatch into is destroyed
+        std::vector<std::unique_ptr<OSCTransport>> mTransports;
     };
 }
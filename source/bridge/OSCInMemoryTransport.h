@@ -0,0 +1,139 @@
+#pragma once
+
+#include "OSCTransport.h"
+#include <juce_core/juce_core.h>
+#include <juce_osc/juce_osc.h>
+#include <vector>
+
+namespace birdhouse
+{
+    /**
+     * @class OSCInMemoryTransport
+     * @brief Transport that is fed pre-encoded OSC packets from memory instead of a socket
+     *
+     * Used by tests and benchmarks to drive the bridge's dispatch path deterministically, without binding a port.
+     * Packets are either injected synchronously on the calling thread, or played back on the transport's own thread
+     * at a fixed rate, which is closer to how the real transports deliver them. Several instances can run in parallel.
+     */
+    class OSCInMemoryTransport : public OSCTransport, private juce::Thread
+    {
+    public:
+        using Packet = std::vector<char>;
+
+        explicit OSCInMemoryTransport (MessageCallback callback)
+            : OSCTransport (std::move (callback)), juce::Thread ("BirdHouse OSC in-memory")
+        {
+        }
+
+        ~OSCInMemoryTransport() override
+        {
+            disconnect();
+        }
+
+        juce::String getName() const override { return "In-memory"; }
+
+        // There is nothing to bind to, the port is ignored
+        bool connect (int port) override
+        {
+            juce::ignoreUnused (port);
+            mConnected.store (true);
+            return true;
+        }
+
+        void disconnect() override
+        {
+            stopPlayback();
+            mConnected.store (false);
+        }
+
+        bool isConnected() const override { return mConnected.load(); }
+
+        // Decode one packet and deliver its messages on the calling thread. Returns false if the packet is malformed.
+        bool inject (const void* data, std::size_t size)
+        {
+            if (!mConnected.load())
+            {
+                return false;
+            }
+
+            mNumPacketsInjected.fetch_add (1, std::memory_order_relaxed);
+            return OSCPacketParser::parse (data, size, mCallback);
+        }
+
+        bool inject (const Packet& packet) { return inject (packet.data(), packet.size()); }
+
+        // Deliver the packets over and over from the transport's thread, packetsPerSecond at a time.
+        // A rate of 0 or less sends as fast as possible.
+        bool startPlayback (std::vector<Packet> packets, double packetsPerSecond)
+        {
+            stopPlayback();
+
+            if (!mConnected.load() || packets.empty())
+            {
+                return false;
+            }
+
+            mPackets = std::move (packets);
+            mPacketsPerSecond = packetsPerSecond;
+            return startThread (mThreadOptions.wantsRealtime() ? juce::Thread::Priority::highest : juce::Thread::Priority::normal);
+        }
+
+        void stopPlayback()
+        {
+            stopThread (2000);
+        }
+
+        auto getNumPacketsInjected() const { return mNumPacketsInjected.load(); }
+        void resetNumPacketsInjected() { mNumPacketsInjected.store (0); }
+
+    private:
+        void run() override
+        {
+            applyThreadOptions();
+
+            const auto ticksPerPacket = mPacketsPerSecond > 0.0
+                                            ? static_cast<juce::int64> (static_cast<double> (juce::Time::getHighResolutionTicksPerSecond()) / mPacketsPerSecond)
+                                            : juce::int64 { 0 };
+            auto nextTick = juce::Time::getHighResolutionTicks();
+            std::size_t index = 0;
+
+            while (!threadShouldExit())
+            {
+                const auto& packet = mPackets[index];
+                inject (packet.data(), packet.size());
+                index = (index + 1) % mPackets.size();
+
+                if (ticksPerPacket == 0)
+                {
+                    continue;
+                }
+
+                // Schedule against absolute times so the average rate does not drift with the cost of each packet
+                nextTick += ticksPerPacket;
+                const auto ticksToWait = nextTick - juce::Time::getHighResolutionTicks();
+
+                if (ticksToWait > 0)
+                {
+                    const auto millisecondsToWait = juce::Time::highResolutionTicksToSeconds (ticksToWait) * 1000.0;
+
+                    // Sleep for the coarse part, spin for the last millisecond
+                    if (millisecondsToWait > 1.0)
+                    {
+                        wait (static_cast<int> (millisecondsToWait) - 1);
+                    }
+
+                    while (juce::Time::getHighResolutionTicks() < nextTick && !threadShouldExit())
+                    {
+                    }
+                }
+            }
+
+            resetThreadState();
+        }
+
+        std::atomic<bool> mConnected { false };
+        std::atomic<juce::uint64> mNumPacketsInjected { 0 };
+        std::vector<Packet> mPackets;
+        double mPacketsPerSecond { 0.0 };
+    };
+}
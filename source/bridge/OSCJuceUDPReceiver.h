@@ -0,0 +1,77 @@
+#pragma once
+
+#include "OSCTransport.h"
+#include <juce_core/juce_core.h>
+#include <juce_osc/juce_osc.h>
+
+namespace birdhouse
+{
+    /**
+     * @class OSCJuceUDPReceiver
+     * @brief UDP transport built on juce::OSCReceiver
+     *
+     * This is how the bridge received OSC before it had its own UDP thread. It is kept as a reference point for
+     * benchmarks and as a fallback on platforms where OSCUDPReceiver's raw socket handling is not wanted.
+     * The thread belongs to JUCE, so ReceiveThreadOptions are ignored.
+     */
+    class OSCJuceUDPReceiver : public OSCTransport, private juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>
+    {
+    public:
+        explicit OSCJuceUDPReceiver (MessageCallback callback)
+            : OSCTransport (std::move (callback))
+        {
+            mReceiver.addListener (this);
+        }
+
+        ~OSCJuceUDPReceiver() override
+        {
+            disconnect();
+            mReceiver.removeListener (this);
+        }
+
+        juce::String getName() const override { return "JUCE UDP"; }
+
+        bool connect (int port) override
+        {
+            disconnect();
+            mConnected = mReceiver.connect (port);
+            return mConnected;
+        }
+
+        void disconnect() override
+        {
+            if (mConnected)
+            {
+                mReceiver.disconnect();
+                mConnected = false;
+            }
+        }
+
+        bool isConnected() const override { return mConnected; }
+
+    private:
+        void oscMessageReceived (const juce::OSCMessage& message) override
+        {
+            mCallback (message);
+        }
+
+        // juce::OSCReceiver hands bundles over whole, unpack them the same way OSCPacketParser does
+        void oscBundleReceived (const juce::OSCBundle& bundle) override
+        {
+            for (auto& element : bundle)
+            {
+                if (element.isMessage())
+                {
+                    mCallback (element.getMessage());
+                }
+                else if (element.isBundle())
+                {
+                    oscBundleReceived (element.getBundle());
+                }
+            }
+        }
+
+        juce::OSCReceiver mReceiver;
+        bool mConnected { false };
+    };
+}
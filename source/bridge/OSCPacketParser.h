@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <juce_osc/juce_osc.h>
+
+namespace birdhouse
+{
+    /**
+     * @class OSCPacketParser
+     * @brief Decodes raw OSC 1.0 packets (messages and bundles) into juce::OSCMessage
+     *
+     * juce::OSCReceiver only decodes what it reads from its own UDP socket, so the other transports of the bridge use
+     * this to turn their packets into the same message objects that the UDP path dispatches.
+     * Bundle time tags are ignored and the contained messages are delivered immediately, like the UDP path does.
+     */
+    class OSCPacketParser
+    {
+    public:
+        using MessageCallback = std::function<void (const juce::OSCMessage&)>;
+
+        // Returns false if the packet (or any element of a bundle) was malformed or used unsupported argument types
+        template <typename Callback>
+        static bool parse (const void* data, std::size_t size, Callback&& onMessage)
+        {
+            return parsePacket (static_cast<const char*> (data), size, onMessage, 0);
+        }
+
+        static bool isBundle (const void* data, std::size_t size)
+        {
+            return size >= bundleTagSize && std::memcmp (data, "#bundle", bundleTagSize) == 0;
+        }
+
+    private:
+        static constexpr std::size_t bundleTagSize = 8; // "#bundle\0"
+        static constexpr int maxBundleDepth = 8;
+
+        template <typename Callback>
+        static bool parsePacket (const char* data, std::size_t size, Callback& onMessage, int depth)
+        {
+            if (size == 0 || (size % 4) != 0)
+            {
+                return false;
+            }
+
+            if (isBundle (data, size))
+            {
+                return parseBundle (data, size, onMessage, depth);
+            }
+
+            return parseMessage (data, size, onMessage);
+        }
+
+        template <typename Callback>
+        static bool parseBundle (const char* data, std::size_t size, Callback& onMessage, int depth)
+        {
+            if (depth >= maxBundleDepth || size < bundleTagSize + 8)
+            {
+                return false;
+            }
+
+            // Skip "#bundle" and the 64 bit time tag
+            auto pos = bundleTagSize + 8;
+            auto ok = true;
+
+            while (pos + 4 <= size)
+            {
+                const auto elementSize = static_cast<std::size_t> (readInt32 (data + pos));
+                pos += 4;
+
+                if (elementSize > size - pos)
+                {
+                    return false;
+                }
+
+                ok = parsePacket (data + pos, elementSize, onMessage, depth + 1) && ok;
+                pos += elementSize;
+            }
+
+            return ok && pos == size;
+        }
+
+        template <typename Callback>
+        static bool parseMessage (const char* data, std::size_t size, Callback& onMessage)
+        {
+            auto pos = std::size_t { 0 };
+
+            const auto* address = readString (data, size, pos);
+            if (address == nullptr || address[0] != '/')
+            {
+                return false;
+            }
+
+            // The type tag string may be missing in very old implementations, treat that as no arguments
+            const auto* typeTags = (pos < size) ? readString (data, size, pos) : ",";
+            if (typeTags == nullptr || typeTags[0] != ',')
+            {
+                return false;
+            }
+
+            try
+            {
+                juce::OSCMessage message { juce::OSCAddressPattern (juce::String::fromUTF8 (address)) };
+
+                for (const auto* tag = typeTags + 1; *tag != '\0'; ++tag)
+                {
+                    switch (*tag)
+                    {
+                        case 'i':
+                            if (size - pos < 4)
+                                return false;
+                            message.addInt32 (readInt32 (data + pos));
+                            pos += 4;
+                            break;
+                        case 'f':
+                            if (size - pos < 4)
+                                return false;
+                            message.addFloat32 (readFloat32 (data + pos));
+                            pos += 4;
+                            break;
+                        case 's':
+                        {
+                            const auto* string = readString (data, size, pos);
+                            if (string == nullptr)
+                                return false;
+                            message.addString (juce::String::fromUTF8 (string));
+                            break;
+                        }
+                        case 'b':
+                        {
+                            if (size - pos < 4)
+                                return false;
+                            // Checked before padding, a length near the top of the range would wrap around
+                            const auto blobSize = static_cast<std::size_t> (juce::ByteOrder::bigEndianInt (data + pos));
+                            pos += 4;
+                            if (blobSize > size - pos)
+                                return false;
+                            const auto paddedSize = (blobSize + 3) & ~std::size_t { 3 };
+                            if (paddedSize > size - pos)
+                                return false;
+                            message.addBlob (juce::MemoryBlock (data + pos, blobSize));
+                            pos += paddedSize;
+                            break;
+                        }
+                        default:
+                            // juce::OSCArgument has no representation for the remaining OSC 1.1 types
+                            return false;
+                    }
+                }
+
+                onMessage (message);
+            }
+            catch (const juce::OSCFormatError& error)
+            {
+                DBG ("OSCPacketParser: dropping message with invalid address: " + juce::String (error.description));
+                return false;
+            }
+
+            return true;
+        }
+
+        // Returns a pointer to a null terminated, 4 byte padded OSC string and advances pos past it
+        static const char* readString (const char* data, std::size_t size, std::size_t& pos)
+        {
+            const auto* start = data + pos;
+            const auto* terminator = static_cast<const char*> (std::memchr (start, '\0', size - pos));
+
+            if (terminator == nullptr)
+            {
+                return nullptr;
+            }
+
+            const auto length = static_cast<std::size_t> (terminator - start);
+            const auto paddedLength = (length + 4) & ~std::size_t { 3 };
+
+            if (paddedLength > size - pos)
+            {
+                return nullptr;
+            }
+
+            pos += paddedLength;
+            return start;
+        }
+
+        static std::int32_t readInt32 (const char* data)
+        {
+            return static_cast<std::int32_t> (juce::ByteOrder::bigEndianInt (data));
+        }
+
+        static float readFloat32 (const char* data)
+        {
+            const auto bits = juce::ByteOrder::bigEndianInt (data);
+            float value;
+            std::memcpy (&value, &bits, sizeof (value));
+            return value;
+        }
+    };
+}
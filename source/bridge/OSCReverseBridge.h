@@ -0,0 +1,192 @@
+#pragma once
+
+#include "EventFifo.h"
+#include "MidiEvent.h"
+#include "OSCBridgeChannel.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include <juce_osc/juce_osc.h>
+
+namespace birdhouse
+{
+    /**
+     * @class OSCReverseBridge
+     * @brief Sends incoming MIDI back out as OSC, on the paths of the bridge channels it maps to
+     *
+     * The audio thread only pushes events into a lock-free queue. A sender thread wakes up once per interval, keeps
+     * the latest value of each bridge channel and sends everything that changed as one OSC bundle. A token bucket
+     * limits the messages per second; whatever doesn't fit waits for the next bundle, still coalesced to its latest
+     * value, so a burst of automation never floods the network.
+     */
+    class OSCReverseBridge : private juce::Thread
+    {
+    public:
+        using Channels = std::vector<std::shared_ptr<OSCBridgeChannel>>;
+
+        explicit OSCReverseBridge (const Channels& channels)
+            : juce::Thread ("BirdHouse OSC send"), mChannels (channels)
+        {
+        }
+
+        ~OSCReverseBridge() override
+        {
+            stop();
+        }
+
+        // Message thread. Returns false if the sender could not be set up.
+        bool start (const juce::String& host, int port, int intervalMs, int maxMessagesPerSecond)
+        {
+            stop();
+
+            if (!mSender.connect (host, port))
+            {
+                DBG ("OSCReverseBridge: could not connect to " + host + ":" + juce::String (port));
+                return false;
+            }
+
+            mIntervalMs = juce::jmax (1, intervalMs);
+            mMaxMessagesPerSecond = juce::jmax (1, maxMessagesPerSecond);
+            mSlots.assign (mChannels.size(), {});
+            mTokens = 0.0;
+            mNextSlot = 0;
+
+            startThread();
+            mRunning.store (true);
+            return true;
+        }
+
+        void stop()
+        {
+            mRunning.store (false);
+            stopThread (1000);
+            mSender.disconnect();
+        }
+
+        auto isRunning() const { return mRunning.load(); }
+
+        // Audio thread. Queues the channel messages of the block, nothing happens if the bridge isn't running.
+        void handleIncomingMidi (const juce::MidiBuffer& midiMessages)
+        {
+            if (!mRunning.load (std::memory_order_relaxed))
+            {
+                return;
+            }
+
+            for (const auto metadata : midiMessages)
+            {
+                if (metadata.numBytes < 2 || metadata.numBytes > 3 || metadata.data[0] < 0x80 || metadata.data[0] >= 0xf0)
+                {
+                    continue;
+                }
+
+                MidiEvent event;
+                std::copy (metadata.data, metadata.data + metadata.numBytes, event.bytes.begin());
+                event.numBytes = static_cast<juce::uint8> (metadata.numBytes);
+
+                if (!mIncoming.push (event))
+                {
+                    DBG ("OSCReverseBridge: queue full, dropped a MIDI event");
+                }
+            }
+        }
+
+        auto getNumMessagesSent() const { return mNumMessagesSent.load(); }
+
+    private:
+        struct Slot
+        {
+            float value { 0.f };
+            bool dirty { false };
+        };
+
+        void run() override
+        {
+            auto lastTime = juce::Time::getMillisecondCounterHiRes();
+
+            while (!threadShouldExit())
+            {
+                wait (mIntervalMs);
+
+                const auto now = juce::Time::getMillisecondCounterHiRes();
+                const auto burst = static_cast<double> (mMaxMessagesPerSecond) * mIntervalMs / 1000.0;
+                mTokens = juce::jmin (juce::jmax (1.0, burst), mTokens + (now - lastTime) * mMaxMessagesPerSecond / 1000.0);
+                lastTime = now;
+
+                collect();
+                sendBundle();
+            }
+        }
+
+        // Keeps only the latest value per bridge channel
+        void collect()
+        {
+            mIncoming.popAll ([this] (const MidiEvent* events, int numEvents) {
+                for (auto i = 0; i < numEvents; ++i)
+                {
+                    for (std::size_t index = 0; index < mSlots.size(); ++index)
+                    {
+                        auto& state = mChannels[index]->state();
+                        const auto normalized = MidiMessageConverter::toNormalizedValue (events[i], state.outType(), state.outChan(), state.outNum());
+
+                        if (normalized.has_value())
+                        {
+                            mSlots[index] = { juce::jmap (*normalized, state.inMin(), state.inMax()), true };
+                        }
+                    }
+                }
+            });
+        }
+
+        // Starts where the last bundle stopped, so a tight rate limit still gets round to every channel
+        void sendBundle()
+        {
+            juce::OSCBundle bundle;
+            auto numMessages = 0;
+
+            for (std::size_t count = 0; count < mSlots.size() && mTokens >= 1.0; ++count)
+            {
+                const auto index = (mNextSlot + count) % mSlots.size();
+                auto& slot = mSlots[index];
+
+                if (!slot.dirty)
+                {
+                    continue;
+                }
+
+                slot.dirty = false;
+
+                try
+                {
+                    bundle.addElement (juce::OSCMessage (juce::OSCAddressPattern (mChannels[index]->state().path()), slot.value));
+                }
+                catch (const juce::OSCFormatError& error)
+                {
+                    DBG ("OSCReverseBridge: can't send to " + mChannels[index]->state().path() + ": " + error.description);
+                    continue;
+                }
+
+                mTokens -= 1.0;
+                mNextSlot = (index + 1) % mSlots.size();
+                ++numMessages;
+            }
+
+            if (numMessages > 0 && mSender.send (bundle))
+            {
+                mNumMessagesSent.fetch_add (numMessages);
+            }
+        }
+
+        const Channels& mChannels;
+        EventFifo<MidiEvent> mIncoming;
+        juce::OSCSender mSender;
+        std::atomic<bool> mRunning { false };
+        std::atomic<int> mNumMessagesSent { 0 };
+
+        // Sender thread only
+        std::vector<Slot> mSlots;
+        std::size_t mNextSlot { 0 };
+        double mTokens { 0.0 };
+        int mIntervalMs { 20 };
+        int mMaxMessagesPerSecond { 500 };
+    };
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "OSCTransport.h"
+#include <juce_core/juce_core.h>
+#include <juce_osc/juce_osc.h>
+
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+    #include "BirdHouseSharedRing.h"
+    #include <cerrno>
+    #include <csignal>
+    #include <sys/stat.h>
+    #define BIRDHOUSE_HAS_SHARED_RING 1
+#else
+    #define BIRDHOUSE_HAS_SHARED_RING 0
+#endif
+
+namespace birdhouse
+{
+    /**
+     * @class OSCSharedMemoryReceiver
+     * @brief Consumer side of the shared memory ring (see BirdHouseSharedRing.h) for the lowest latency local control.
+     *
+     * Creates the ring, then drains it on its own thread. While packets keep coming it only polls shared memory.
+     * When the ring has been empty for a short while it sleeps on a futex (Linux) or in short naps (elsewhere),
+     * and producers wake it up.
+     */
+    class OSCSharedMemoryReceiver : public OSCTransport, private juce::Thread
+    {
+    public:
+        explicit OSCSharedMemoryReceiver (MessageCallback callback)
+            : OSCTransport (std::move (callback)), juce::Thread ("BirdHouse OSC shared memory")
+        {
+        }
+
+        ~OSCSharedMemoryReceiver() override
+        {
+            disconnect();
+        }
+
+        juce::String getName() const override { return "Shared memory"; }
+
+        bool connect (int port) override
+        {
+            disconnect();
+
+#if BIRDHOUSE_HAS_SHARED_RING
+            char name[64];
+            birdhouse_ring_name (name, sizeof (name), port);
+
+            // Another instance on the same port keeps its ring, like a socket that is already bound
+            if (isRingInUse (name))
+            {
+                DBG ("OSCSharedMemoryReceiver: " + juce::String (name) + " is in use by another instance");
+                return false;
+            }
+
+            // The segment may be left over from a crashed instance. It is recreated, producers have to re-attach.
+            ::shm_unlink (name);
+
+            const auto fd = ::shm_open (name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+            if (fd < 0)
+            {
+                DBG ("OSCSharedMemoryReceiver: could not create " + juce::String (name));
+                return false;
+            }
+
+            const auto truncated = ::ftruncate (fd, sizeof (birdhouse_ring)) == 0;
+            auto* memory = truncated ? ::mmap (nullptr, sizeof (birdhouse_ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+            ::close (fd);
+
+            if (memory == MAP_FAILED)
+            {
+                DBG ("OSCSharedMemoryReceiver: could not map " + juce::String (name));
+                ::shm_unlink (name);
+                return false;
+            }
+
+            mRing = static_cast<birdhouse_ring*> (memory);
+            mRing->capacity = BIRDHOUSE_RING_CAPACITY;
+            mRing->version = BIRDHOUSE_RING_VERSION;
+            mRing->consumer_pid = static_cast<std::uint32_t> (::getpid());
+
+            // Producers check the magic number last, once everything else is in place
+            __atomic_store_n (&mRing->magic, BIRDHOUSE_RING_MAGIC, __ATOMIC_RELEASE);
+
+            mName = name;
+            DBG ("OSCSharedMemoryReceiver: created ring " + mName);
+            return startThread();
+#else
+            juce::ignoreUnused (port);
+            return false;
+#endif
+        }
+
+        void disconnect() override
+        {
+#if BIRDHOUSE_HAS_SHARED_RING
+            if (mRing == nullptr)
+            {
+                return;
+            }
+
+            signalThreadShouldExit();
+            birdhouse_ring_wake_consumer (mRing);
+            stopThread (2000);
+
+            // Only ever our own ring: another instance can't take the name while we hold it
+            mRing->consumer_pid = 0;
+            ::munmap (mRing, sizeof (birdhouse_ring));
+            ::shm_unlink (mName.toRawUTF8());
+            mRing = nullptr;
+            mName = {};
+            resetThreadState();
+#endif
+        }
+
+        bool isConnected() const override { return isThreadRunning(); }
+
+    private:
+#if BIRDHOUSE_HAS_SHARED_RING
+        // Number of empty polls before going to sleep. Keeps the thread hot during bursts without burning a core when idle.
+        static constexpr auto numSpinsBeforeSleeping = 2000;
+
+        void run() override
+        {
+            applyThreadOptions();
+
+            auto numEmptyPolls = 0;
+
+            while (!threadShouldExit())
+            {
+                if (drainRing())
+                {
+                    numEmptyPolls = 0;
+                    continue;
+                }
+
+                if (++numEmptyPolls < numSpinsBeforeSleeping)
+                {
+                    continue;
+                }
+
+                waitForProducer();
+                numEmptyPolls = 0;
+            }
+        }
+
+        // A ring with our magic number whose creator is still running. A process that is gone leaves a stale one.
+        static bool isRingInUse (const char* name)
+        {
+            const auto fd = ::shm_open (name, O_RDONLY, 0);
+            if (fd < 0)
+            {
+                return false;
+            }
+
+            struct stat info;
+            const auto isLargeEnough = ::fstat (fd, &info) == 0 && static_cast<std::size_t> (info.st_size) >= sizeof (birdhouse_ring);
+            auto* memory = isLargeEnough ? ::mmap (nullptr, sizeof (birdhouse_ring), PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+            ::close (fd);
+
+            if (memory == MAP_FAILED)
+            {
+                return false;
+            }
+
+            const auto* ring = static_cast<const birdhouse_ring*> (memory);
+            const auto pid = static_cast<pid_t> (__atomic_load_n (&ring->consumer_pid, __ATOMIC_ACQUIRE));
+            const auto inUse = __atomic_load_n (&ring->magic, __ATOMIC_ACQUIRE) == BIRDHOUSE_RING_MAGIC && pid > 0
+                               && (::kill (pid, 0) == 0 || errno == EPERM);
+
+            ::munmap (memory, sizeof (birdhouse_ring));
+            return inUse;
+        }
+
+        // Returns true if any packets were read
+        bool drainRing()
+        {
+            const auto capacity = static_cast<std::uint64_t> (mRing->capacity);
+            const auto writePos = __atomic_load_n (&mRing->write_pos, __ATOMIC_ACQUIRE);
+            auto readPos = mRing->read_pos;
+
+            if (readPos == writePos)
+            {
+                return false;
+            }
+
+            // The header is writable by every producer, so the capacity has to fit the mapping before it is used
+            if (capacity == 0 || !juce::isPowerOfTwo (capacity) || capacity > sizeof (mRing->data))
+            {
+                DBG ("OSCSharedMemoryReceiver: invalid capacity, dropping ring contents");
+                mRing->capacity = BIRDHOUSE_RING_CAPACITY;
+                __atomic_store_n (&mRing->read_pos, writePos, __ATOMIC_RELEASE);
+                return false;
+            }
+
+            while (readPos != writePos)
+            {
+                const auto offset = readPos & (capacity - 1);
+
+                std::uint32_t size;
+                std::memcpy (&size, mRing->data + offset, sizeof (size));
+
+                // A wrap marker skips to the start of the data. At the start itself it would skip a whole lap.
+                const auto isWrap = size == BIRDHOUSE_RING_WRAP;
+                const auto recordSize = isWrap ? capacity - offset : 4 + ((static_cast<std::uint64_t> (size) + 3) & ~std::uint64_t { 3 });
+
+                // A misbehaving producer could have written garbage, resynchronise by dropping everything
+                if ((isWrap && offset == 0) || offset + recordSize > capacity || readPos + recordSize > writePos)
+                {
+                    DBG ("OSCSharedMemoryReceiver: corrupt record, dropping ring contents");
+                    readPos = writePos;
+                    break;
+                }
+
+                if (isWrap)
+                {
+                    readPos += recordSize;
+                    continue;
+                }
+
+                if (!OSCPacketParser::parse (mRing->data + offset + 4, size, mCallback))
+                {
+                    DBG ("OSCSharedMemoryReceiver: dropped malformed packet of " + juce::String (static_cast<int> (size)) + " bytes");
+                }
+
+                readPos += recordSize;
+            }
+
+            // Only now may the producer reuse the space
+            __atomic_store_n (&mRing->read_pos, readPos, __ATOMIC_RELEASE);
+            return true;
+        }
+
+        void waitForProducer()
+        {
+            const auto seenSignal = __atomic_load_n (&mRing->signal, __ATOMIC_SEQ_CST);
+            __atomic_store_n (&mRing->consumer_waiting, 1u, __ATOMIC_SEQ_CST);
+
+            // Re-check after announcing that we are waiting, a producer may have written in between
+            if (__atomic_load_n (&mRing->write_pos, __ATOMIC_SEQ_CST) == mRing->read_pos)
+            {
+    #if defined(__linux__)
+                // Time out regularly to check if we should exit
+                timespec timeout { 0, 100 * 1000 * 1000 };
+                ::syscall (SYS_futex, &mRing->signal, FUTEX_WAIT, seenSignal, &timeout, nullptr, 0);
+    #else
+                juce::ignoreUnused (seenSignal);
+                juce::Thread::sleep (1);
+    #endif
+            }
+
+            __atomic_store_n (&mRing->consumer_waiting, 0u, __ATOMIC_SEQ_CST);
+        }
+
+        birdhouse_ring* mRing { nullptr };
+#else
+        void run() override {}
+#endif
+
+        juce::String mName;
+    };
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "OSCTransport.h"
+#include "SLIPDecoder.h"
+#include <juce_core/juce_core.h>
+#include <juce_osc/juce_osc.h>
+
+namespace birdhouse
+{
+    /**
+     * @class OSCTCPReceiver
+     * @brief Listens for OSC 1.1 streams over TCP (SLIP framed) from multiple clients at once.
+     *
+     * Each client gets its own reader thread and SLIP decoder, so a slow or stalled client only blocks itself.
+     * The kernel's TCP flow control pushes back on senders that outpace us instead of dropping data like UDP does.
+     * Decoded messages are handed to the same callback as the UDP path.
+     */
+    class OSCTCPReceiver : public OSCTransport, private juce::Thread
+    {
+    public:
+        static constexpr std::size_t maxClients = 16;
+
+        explicit OSCTCPReceiver (MessageCallback callback)
+            : OSCTransport (std::move (callback)), juce::Thread ("BirdHouse OSC TCP listener")
+        {
+        }
+
+        ~OSCTCPReceiver() override
+        {
+            disconnect();
+        }
+
+        juce::String getName() const override { return "TCP"; }
+
+        // Takes effect on the next connect(). By default only programs on this computer can connect.
+        void setLocalOnly (bool shouldBeLocalOnly) { mLocalOnly = shouldBeLocalOnly; }
+
+        bool connect (int port) override
+        {
+            disconnect();
+
+            mListener = std::make_unique<juce::StreamingSocket>();
+            if (!mListener->createListener (port, mLocalOnly ? "127.0.0.1" : juce::String()))
+            {
+                DBG ("OSCTCPReceiver: could not listen on port " + juce::String (port));
+                mListener.reset();
+                return false;
+            }
+
+            DBG ("OSCTCPReceiver: listening on port " + juce::String (port));
+            return startThread();
+        }
+
+        void disconnect() override
+        {
+            if (mListener == nullptr)
+            {
+                return;
+            }
+
+            // Closing the listener wakes up the blocking accept in run()
+            signalThreadShouldExit();
+            mListener->close();
+            stopThread (2000);
+            mListener.reset();
+
+            const juce::ScopedLock lock (mConnectionsLock);
+            mConnections.clear();
+            resetThreadState();
+        }
+
+        bool isConnected() const override { return mListener != nullptr && mListener->isConnected(); }
+
+        int getNumClients() const
+        {
+            const juce::ScopedLock lock (mConnectionsLock);
+            auto numClients = 0;
+            for (auto& connection : mConnections)
+            {
+                numClients += connection->isFinished() ? 0 : 1;
+            }
+
+            return numClients;
+        }
+
+    private:
+        /**
+         * @class Connection
+         * @brief Reads and SLIP-decodes the stream of one client on its own thread
+         */
+        class Connection : private juce::Thread
+        {
+        public:
+            Connection (std::unique_ptr<juce::StreamingSocket> socket, const MessageCallback& callback, const ReceiveThreadOptions& options)
+                : juce::Thread ("BirdHouse OSC TCP client"), mSocket (std::move (socket)), mCallback (callback), mOptions (options)
+            {
+                startThread();
+            }
+
+            ~Connection() override
+            {
+                signalThreadShouldExit();
+                stopThread (2000);
+                mSocket->close();
+            }
+
+            bool isFinished() const { return mFinished.load(); }
+
+        private:
+            void run() override
+            {
+                mOptions.applyToCurrentThread();
+
+                while (!threadShouldExit())
+                {
+                    // Wake up regularly to check if we should exit
+                    const auto ready = mSocket->waitUntilReady (true, 100);
+
+                    if (ready < 0)
+                    {
+                        break;
+                    }
+
+                    if (ready == 0)
+                    {
+                        continue;
+                    }
+
+                    const auto numRead = mSocket->read (mReadBuffer.data(), static_cast<int> (mReadBuffer.size()), false);
+
+                    // 0 bytes after the socket reported ready means the client closed the connection
+                    if (numRead <= 0)
+                    {
+                        break;
+                    }
+
+                    mDecoder.feed (mReadBuffer.data(), static_cast<std::size_t> (numRead), [this] (const std::uint8_t* frame, std::size_t frameSize) {
+                        if (!OSCPacketParser::parse (frame, frameSize, mCallback))
+                        {
+                            DBG ("OSCTCPReceiver: dropped malformed packet of " + juce::String (static_cast<int> (frameSize)) + " bytes");
+                        }
+                    });
+                }
+
+                DBG ("OSCTCPReceiver: client disconnected");
+                mDecoder.reset();
+                mFinished.store (true);
+            }
+
+            std::unique_ptr<juce::StreamingSocket> mSocket;
+            const MessageCallback& mCallback;
+            ReceiveThreadOptions mOptions;
+            std::array<char, 4096> mReadBuffer {};
+            SLIPDecoder<> mDecoder;
+            std::atomic<bool> mFinished { false };
+        };
+
+        void run() override
+        {
+            applyThreadOptions();
+
+            while (!threadShouldExit())
+            {
+                std::unique_ptr<juce::StreamingSocket> client (mListener->waitForNextConnection());
+
+                if (threadShouldExit())
+                {
+                    break;
+                }
+
+                if (client == nullptr)
+                {
+                    // Avoid spinning if accept keeps failing
+                    wait (10);
+                    continue;
+                }
+
+                const juce::ScopedLock lock (mConnectionsLock);
+
+                // Clean up clients that have gone away before accepting new ones
+                mConnections.erase (std::remove_if (mConnections.begin(), mConnections.end(), [] (auto& connection) { return connection->isFinished(); }),
+                    mConnections.end());
+
+                if (mConnections.size() >= maxClients)
+                {
+                    DBG ("OSCTCPReceiver: refusing client, too many connections");
+                    continue;
+                }
+
+                DBG ("OSCTCPReceiver: client connected from " + client->getHostName());
+                mConnections.push_back (std::make_unique<Connection> (std::move (client), mCallback, mThreadOptions));
+            }
+        }
+
+        std::unique_ptr<juce::StreamingSocket> mListener;
+        bool mLocalOnly { true };
+
+        juce::CriticalSection mConnectionsLock;
+        std::vector<std::unique_ptr<Connection>> mConnections;
+    };
+}
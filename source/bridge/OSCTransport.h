@@ -0,0 +1,66 @@
+#pragma once
+
+#include "OSCPacketParser.h"
+#include "ReceiveThreadOptions.h"
+#include <juce_core/juce_core.h>
+#include <juce_osc/juce_osc.h>
+
+namespace birdhouse
+{
+    /**
+     * @class OSCTransport
+     * @brief Interface for everything that can deliver OSC messages to the bridge
+     *
+     * A transport receives packets from somewhere (a socket, shared memory, or memory in tests and benchmarks),
+     * decodes them and hands each message to the callback it was constructed with. OSCBridgeManager owns a list of
+     * transports and routes whatever they deliver to its channels, so the dispatch path does not care where
+     * messages come from.
+     */
+    class OSCTransport
+    {
+    public:
+        using MessageCallback = OSCPacketParser::MessageCallback;
+
+        explicit OSCTransport (MessageCallback callback) : mCallback (std::move (callback)) {}
+        virtual ~OSCTransport() = default;
+
+        virtual juce::String getName() const = 0;
+
+        // Start receiving. Transports derive their address from the bridge port (UDP/TCP port, socket path, ring name).
+        virtual bool connect (int port) = 0;
+        virtual void disconnect() = 0;
+        virtual bool isConnected() const = 0;
+
+        // A disabled transport is left alone by OSCBridgeManager::startListening
+        void setEnabled (bool shouldBeEnabled) { mEnabled.store (shouldBeEnabled); }
+        bool isEnabled() const { return mEnabled.load(); }
+
+        // Scheduling for transports that receive on their own thread. Takes effect on the next connect().
+        void setThreadOptions (const ReceiveThreadOptions& options) { mThreadOptions = options; }
+
+        // True if the receive thread actually got SCHED_FIFO/SCHED_RR
+        bool isRealtimeActive() const { return mRealtimeActive.load(); }
+
+        // Transports that can measure how long packets wait before being read return their statistics here
+        virtual const ReceiveLatencyStats* getLatencyStats() const { return nullptr; }
+
+    protected:
+        // Call at the start of a transport's receive thread
+        void applyThreadOptions()
+        {
+            mRealtimeActive.store (mThreadOptions.applyToCurrentThread());
+        }
+
+        void resetThreadState()
+        {
+            mRealtimeActive.store (false);
+        }
+
+        MessageCallback mCallback;
+        ReceiveThreadOptions mThreadOptions;
+
+    private:
+        std::atomic<bool> mRealtimeActive { false };
+        std::atomic<bool> mEnabled { true };
+    };
+}
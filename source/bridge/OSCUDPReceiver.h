@@ -0,0 +1,192 @@
+#pragma once
+
+#include "OSCTransport.h"
+#include <juce_core/juce_core.h>
+#include <juce_osc/juce_osc.h>
+
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <time.h>
+    #define BIRDHOUSE_HAS_RECEIVE_TIMESTAMPS 1
+#else
+    #define BIRDHOUSE_HAS_RECEIVE_TIMESTAMPS 0
+#endif
+
+namespace birdhouse
+{
+    /**
+     * @class OSCUDPReceiver
+     * @brief Receives OSC over UDP on a thread owned by the bridge, with configurable scheduling.
+     *
+     * Unlike juce::OSCReceiver, the thread's scheduling policy, priority and cpu affinity can be set (see
+     * ReceiveThreadOptions). Where the OS supports kernel receive timestamps (Linux, macOS) the time each packet
+     * waited before the thread picked it up is measured, which is a direct measure of scheduling latency.
+     */
+    class OSCUDPReceiver : public OSCTransport, private juce::Thread
+    {
+    public:
+        explicit OSCUDPReceiver (MessageCallback callback)
+            : OSCTransport (std::move (callback)), juce::Thread ("BirdHouse OSC UDP")
+        {
+        }
+
+        ~OSCUDPReceiver() override
+        {
+            disconnect();
+        }
+
+        juce::String getName() const override { return "UDP"; }
+
+        bool connect (int port) override
+        {
+            disconnect();
+
+            mSocket = std::make_unique<juce::DatagramSocket> (false);
+            if (!mSocket->bindToPort (port))
+            {
+                DBG ("OSCUDPReceiver: could not bind to port " + juce::String (port));
+                mSocket.reset();
+                return false;
+            }
+
+#if BIRDHOUSE_HAS_RECEIVE_TIMESTAMPS
+            const int enable = 1;
+    #if JUCE_LINUX
+            mHasTimestamps = ::setsockopt (mSocket->getRawSocketHandle(), SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof (enable)) == 0;
+    #else
+            mHasTimestamps = ::setsockopt (mSocket->getRawSocketHandle(), SOL_SOCKET, SO_TIMESTAMP, &enable, sizeof (enable)) == 0;
+    #endif
+#endif
+
+            mLatency.reset();
+
+            // Ask JUCE for the highest normal priority up front, run() upgrades to realtime scheduling if allowed
+            return mThreadOptions.wantsRealtime() ? startThread (juce::Thread::Priority::highest) : startThread();
+        }
+
+        void disconnect() override
+        {
+            if (mSocket == nullptr)
+            {
+                return;
+            }
+
+            signalThreadShouldExit();
+            mSocket->shutdown();
+            stopThread (2000);
+            mSocket.reset();
+            resetThreadState();
+        }
+
+        bool isConnected() const override { return mSocket != nullptr; }
+
+        const ReceiveLatencyStats* getLatencyStats() const override { return &mLatency; }
+
+    private:
+        void run() override
+        {
+            applyThreadOptions();
+
+            while (!threadShouldExit())
+            {
+                // Wake up regularly to check if we should exit
+                const auto ready = mSocket->waitUntilReady (true, 100);
+
+                if (ready < 0)
+                {
+                    break;
+                }
+
+                if (ready == 0)
+                {
+                    continue;
+                }
+
+                const auto numRead = receivePacket();
+
+                if (numRead <= 0)
+                {
+                    continue;
+                }
+
+                if (!OSCPacketParser::parse (mReadBuffer.data(), static_cast<std::size_t> (numRead), mCallback))
+                {
+                    DBG ("OSCUDPReceiver: dropped malformed packet of " + juce::String (numRead) + " bytes");
+                }
+            }
+        }
+
+        int receivePacket()
+        {
+#if BIRDHOUSE_HAS_RECEIVE_TIMESTAMPS
+            if (mHasTimestamps)
+            {
+                iovec buffer { mReadBuffer.data(), mReadBuffer.size() };
+                alignas (cmsghdr) char control[64];
+
+                msghdr header {};
+                header.msg_iov = &buffer;
+                header.msg_iovlen = 1;
+                header.msg_control = control;
+                header.msg_controllen = sizeof (control);
+
+                const auto numRead = ::recvmsg (mSocket->getRawSocketHandle(), &header, 0);
+
+                if (numRead > 0)
+                {
+                    measureLatency (header);
+                }
+
+                return static_cast<int> (numRead);
+            }
+#endif
+
+            return mSocket->read (mReadBuffer.data(), static_cast<int> (mReadBuffer.size()), false);
+        }
+
+#if BIRDHOUSE_HAS_RECEIVE_TIMESTAMPS
+        // The kernel stamps packets with the wall clock when they arrive, compare with the wall clock now
+        void measureLatency (msghdr& header)
+        {
+            for (auto* message = CMSG_FIRSTHDR (&header); message != nullptr; message = CMSG_NXTHDR (&header, message))
+            {
+                if (message->cmsg_level != SOL_SOCKET)
+                {
+                    continue;
+                }
+
+    #if JUCE_LINUX
+                if (message->cmsg_type == SCM_TIMESTAMPNS)
+                {
+                    timespec arrived {}, now {};
+                    std::memcpy (&arrived, CMSG_DATA (message), sizeof (arrived));
+                    ::clock_gettime (CLOCK_REALTIME, &now);
+
+                    const auto latencyNanoseconds = static_cast<double> (now.tv_sec - arrived.tv_sec) * 1.0e9 + static_cast<double> (now.tv_nsec - arrived.tv_nsec);
+                    mLatency.addMeasurement (latencyNanoseconds / 1000.0);
+                }
+    #else
+                if (message->cmsg_type == SCM_TIMESTAMP)
+                {
+                    timeval arrived {}, now {};
+                    std::memcpy (&arrived, CMSG_DATA (message), sizeof (arrived));
+                    ::gettimeofday (&now, nullptr);
+
+                    const auto latencyMicroseconds = static_cast<double> (now.tv_sec - arrived.tv_sec) * 1.0e6 + static_cast<double> (now.tv_usec - arrived.tv_usec);
+                    mLatency.addMeasurement (latencyMicroseconds);
+                }
+    #endif
+            }
+        }
+
+        bool mHasTimestamps { false };
+#endif
+
+        std::unique_ptr<juce::DatagramSocket> mSocket;
+        ReceiveLatencyStats mLatency;
+
+        // Same maximum packet size as juce::OSCReceiver
+        std::array<char, 65507> mReadBuffer {};
+    };
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "OSCTransport.h"
+#include <juce_core/juce_core.h>
+#include <juce_osc/juce_osc.h>
+
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+    #define BIRDHOUSE_HAS_UNIX_SOCKETS 1
+#else
+    #define BIRDHOUSE_HAS_UNIX_SOCKETS 0
+#endif
+
+namespace birdhouse
+{
+    /**
+     * @class OSCUnixSocketReceiver
+     * @brief Receives OSC packets on a Unix domain datagram socket, for senders running on the same machine.
+     *
+     * Skips the UDP/IP stack entirely, which makes each message cheaper than going through the loopback interface.
+     * The packets are plain OSC, exactly as they would have been sent over UDP, and are handed to the same callback.
+     * On platforms without Unix domain sockets connect() always fails.
+     */
+    class OSCUnixSocketReceiver : public OSCTransport, private juce::Thread
+    {
+    public:
+        explicit OSCUnixSocketReceiver (MessageCallback callback)
+            : OSCTransport (std::move (callback)), juce::Thread ("BirdHouse OSC Unix socket")
+        {
+        }
+
+        ~OSCUnixSocketReceiver() override
+        {
+            disconnect();
+        }
+
+        // Default socket path used for a given port number, so senders can find it without extra configuration
+        static juce::String getDefaultPathForPort (int port)
+        {
+            return "/tmp/birdhouse-" + juce::String (port) + ".osc";
+        }
+
+        juce::String getName() const override { return "Unix socket"; }
+
+        bool connect (int port) override
+        {
+            return connectToPath (getDefaultPathForPort (port));
+        }
+
+        bool connectToPath (const juce::String& path)
+        {
+            disconnect();
+
+#if BIRDHOUSE_HAS_UNIX_SOCKETS
+            sockaddr_un address {};
+            address.sun_family = AF_UNIX;
+
+            if (path.getNumBytesAsUTF8() >= sizeof (address.sun_path))
+            {
+                DBG ("OSCUnixSocketReceiver: socket path too long: " + path);
+                return false;
+            }
+
+            std::strncpy (address.sun_path, path.toRawUTF8(), sizeof (address.sun_path) - 1);
+
+            mSocket = ::socket (AF_UNIX, SOCK_DGRAM, 0);
+            if (mSocket < 0)
+            {
+                DBG ("OSCUnixSocketReceiver: could not create socket");
+                return false;
+            }
+
+            // Remove a stale socket left behind by a crashed instance, but never anything that isn't a socket
+            // and never a socket that another instance is still listening on
+            struct stat fileInfo {};
+            if (::lstat (address.sun_path, &fileInfo) == 0 && S_ISSOCK (fileInfo.st_mode))
+            {
+                if (::connect (mSocket, reinterpret_cast<const sockaddr*> (&address), sizeof (address)) == 0)
+                {
+                    DBG ("OSCUnixSocketReceiver: " + path + " is in use by another instance");
+                    ::close (mSocket);
+                    mSocket = -1;
+                    return false;
+                }
+
+                ::unlink (address.sun_path);
+            }
+
+            if (::bind (mSocket, reinterpret_cast<const sockaddr*> (&address), sizeof (address)) != 0)
+            {
+                DBG ("OSCUnixSocketReceiver: could not bind to " + path);
+                ::close (mSocket);
+                mSocket = -1;
+                return false;
+            }
+
+            mPath = path;
+            DBG ("OSCUnixSocketReceiver: listening on " + path);
+            return startThread();
+#else
+            juce::ignoreUnused (path);
+            return false;
+#endif
+        }
+
+        void disconnect() override
+        {
+#if BIRDHOUSE_HAS_UNIX_SOCKETS
+            if (mSocket < 0)
+            {
+                return;
+            }
+
+            signalThreadShouldExit();
+            stopThread (2000);
+
+            ::close (mSocket);
+            ::unlink (mPath.toRawUTF8());
+            mSocket = -1;
+            mPath = {};
+            resetThreadState();
+#endif
+        }
+
+        bool isConnected() const override { return mSocket >= 0; }
+
+        auto getPath() const { return mPath; }
+
+    private:
+        void run() override
+        {
+#if BIRDHOUSE_HAS_UNIX_SOCKETS
+            applyThreadOptions();
+
+            pollfd descriptor { mSocket, POLLIN, 0 };
+
+            while (!threadShouldExit())
+            {
+                // Wake up regularly to check if we should exit
+                const auto ready = ::poll (&descriptor, 1, 100);
+
+                if (ready <= 0)
+                {
+                    continue;
+                }
+
+                const auto numRead = ::recv (mSocket, mReadBuffer.data(), mReadBuffer.size(), 0);
+
+                if (numRead <= 0)
+                {
+                    continue;
+                }
+
+                if (!OSCPacketParser::parse (mReadBuffer.data(), static_cast<std::size_t> (numRead), mCallback))
+                {
+                    DBG ("OSCUnixSocketReceiver: dropped malformed packet of " + juce::String (static_cast<int> (numRead)) + " bytes");
+                }
+            }
+#endif
+        }
+
+        int mSocket { -1 };
+        juce::String mPath;
+
+        // Same maximum packet size as juce::OSCReceiver
+        std::array<char, 65507> mReadBuffer {};
+    };
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <juce_core/juce_core.h>
+
+namespace birdhouse
+{
+    /**
+     * @class PublishedValue
+     * @brief A value written by one thread and read by others without locks, kept in two slots
+     *
+     * The writer fills the slot that isn't current and then makes it current with one atomic store. Readers register
+     * with the slot they read from for as long as they hold it, and the writer waits for a slot's last reader to leave
+     * before writing to it again. So a reader never sees a half written value, however quickly writes follow each
+     * other. Reading never waits, it only tries again if the current slot changed while it was registering.
+     *
+     * Readers only hold a slot for a short computation, so the writer's wait is short too. It is meant for the
+     * message thread, not the audio thread.
+     */
+    template <typename T>
+    class PublishedValue
+    {
+    public:
+        // The current value, held for as long as this lives
+        class Reader
+        {
+        public:
+            explicit Reader (const PublishedValue& owner)
+            {
+                for (;;)
+                {
+                    const auto index = owner.mCurrent.load();
+                    auto& numReaders = owner.mNumReaders[static_cast<std::size_t> (index)];
+                    numReaders.fetch_add (1);
+
+                    // The writer may have started on this slot before we registered, then it isn't current anymore
+                    if (owner.mCurrent.load() == index)
+                    {
+                        mValue = &owner.mSlots[static_cast<std::size_t> (index)];
+                        mNumReaders = &numReaders;
+                        return;
+                    }
+
+                    numReaders.fetch_sub (1);
+                }
+            }
+
+            ~Reader() { mNumReaders->fetch_sub (1); }
+
+            Reader (const Reader&) = delete;
+            Reader& operator= (const Reader&) = delete;
+
+            const T& operator*() const { return *mValue; }
+            const T* operator->() const { return mValue; }
+
+        private:
+            const T* mValue { nullptr };
+            std::atomic<int>* mNumReaders { nullptr };
+        };
+
+        // One writing thread. write (T&) fills in the new value, in a slot that still holds an older one.
+        template <typename WriteCallback>
+        void publishWith (WriteCallback&& write)
+        {
+            const auto next = 1 - mCurrent.load();
+
+            while (mNumReaders[static_cast<std::size_t> (next)].load() != 0)
+            {
+                juce::Thread::yield();
+            }
+
+            write (mSlots[static_cast<std::size_t> (next)]);
+            mCurrent.store (next);
+        }
+
+        void publish (const T& value)
+        {
+            publishWith ([&value] (T& slot) { slot = value; });
+        }
+
+        // Any thread
+        Reader read() const { return Reader (*this); }
+
+    private:
+        std::array<T, 2> mSlots {};
+        std::atomic<int> mCurrent { 0 };
+        mutable std::array<std::atomic<int>, 2> mNumReaders {};
+    };
+}
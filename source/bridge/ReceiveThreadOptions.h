@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <juce_core/juce_core.h>
+
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+namespace birdhouse
+{
+    enum SchedulingPolicy {
+        SchedulingNormal,
+        SchedulingFifo,
+        SchedulingRoundRobin,
+        NumSchedulingPolicies
+    };
+
+    /**
+     * @class ReceiveThreadOptions
+     * @brief Scheduling settings for the bridge's receive thread
+     *
+     * With SCHED_FIFO/SCHED_RR the receive thread is no longer preempted by a busy DAW, which keeps OSC events from
+     * arriving blocks late. Realtime scheduling usually needs extra permissions (rtprio in limits.conf on Linux).
+     * Without them the thread falls back to the highest normal priority and keeps working.
+     */
+    struct ReceiveThreadOptions
+    {
+        SchedulingPolicy policy { SchedulingNormal };
+        int priority { 80 }; // 1 - 99, only used for SchedulingFifo and SchedulingRoundRobin
+        juce::uint32 affinityMask { 0 }; // Bit n allows cpu n. 0 means any cpu
+
+        // From the numbers stored in the plugin state, each kept in its valid range
+        static ReceiveThreadOptions fromSettings (int policy, int priority, int affinityMask)
+        {
+            ReceiveThreadOptions options;
+            options.policy = static_cast<SchedulingPolicy> (juce::jlimit (0, NumSchedulingPolicies - 1, policy));
+            options.priority = juce::jlimit (1, 99, priority);
+            options.affinityMask = static_cast<juce::uint32> (affinityMask);
+            return options;
+        }
+
+        auto wantsRealtime() const { return policy == SchedulingFifo || policy == SchedulingRoundRobin; }
+
+        // Call this from the receive thread itself. Returns true if realtime scheduling is active afterwards.
+        bool applyToCurrentThread() const
+        {
+            if (affinityMask != 0)
+            {
+                juce::Thread::setCurrentThreadAffinityMask (affinityMask);
+            }
+
+            if (!wantsRealtime())
+            {
+                return false;
+            }
+
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+            const auto nativePolicy = policy == SchedulingFifo ? SCHED_FIFO : SCHED_RR;
+            sched_param param {};
+            param.sched_priority = juce::jlimit (sched_get_priority_min (nativePolicy), sched_get_priority_max (nativePolicy), priority);
+
+            const auto result = pthread_setschedparam (pthread_self(), nativePolicy, &param);
+            if (result != 0)
+            {
+                DBG ("ReceiveThreadOptions: could not enable realtime scheduling (error " + juce::String (result) + "), falling back to normal scheduling");
+                return false;
+            }
+
+            return true;
+#else
+            return false;
+#endif
+        }
+    };
+
+    /**
+     * @class ReceiveLatencyStats
+     * @brief Tracks how long packets wait in the kernel before the receive thread gets to them
+     *
+     * Written by the receive thread, read from anywhere.
+     */
+    class ReceiveLatencyStats
+    {
+    public:
+        void addMeasurement (double latencyMicroseconds)
+        {
+            const auto latency = static_cast<float> (latencyMicroseconds);
+            const auto previousAverage = mAverage.load (std::memory_order_relaxed);
+            const auto isFirst = mNumMeasurements.fetch_add (1, std::memory_order_relaxed) == 0;
+
+            mLast.store (latency, std::memory_order_relaxed);
+            mAverage.store (isFirst ? latency : previousAverage + averageCoefficient * (latency - previousAverage), std::memory_order_relaxed);
+
+            if (latency > mMax.load (std::memory_order_relaxed))
+            {
+                mMax.store (latency, std::memory_order_relaxed);
+            }
+        }
+
+        void reset()
+        {
+            mNumMeasurements.store (0);
+            mLast.store (0.f);
+            mAverage.store (0.f);
+            mMax.store (0.f);
+        }
+
+        auto lastMicroseconds() const { return mLast.load(); }
+        auto averageMicroseconds() const { return mAverage.load(); }
+        auto maxMicroseconds() const { return mMax.load(); }
+        auto numMeasurements() const { return mNumMeasurements.load(); }
+
+    private:
+        // Exponential moving average, roughly the last 100 packets
+        static constexpr float averageCoefficient = 0.01f;
+
+        std::atomic<juce::uint64> mNumMeasurements { 0 };
+        std::atomic<float> mLast { 0.f }, mAverage { 0.f }, mMax { 0.f };
+    };
+}
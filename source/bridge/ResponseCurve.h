@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <juce_core/juce_core.h>
+#include <vector>
+
+namespace birdhouse
+{
+    enum CurveType {
+        CurveLinear,
+        CurveExponential,
+        CurveLogarithmic,
+        CurveSCurve,
+        CurveBreakpoints,
+        NumCurveTypes
+    };
+
+    /**
+     * @class ResponseCurve
+     * @brief Reshapes a channel's normalized value, from a lookup table computed whenever the curve changes
+     *
+     * The curve is only evaluated with exp / tanh when it is set, on the message thread. Per message it costs a table
+     * read and a linear interpolation between two entries. The entries are relaxed atomics, so the OSC and audio
+     * threads can read while a new curve is written; at worst a value in the middle of a change mixes the old and the
+     * new curve.
+     */
+    class ResponseCurve
+    {
+    public:
+        static constexpr int tableSize = 256;
+
+        // Beyond this the curves are a step anyway, and exp would overflow a float not much further
+        static constexpr float maxAmount = 40.f;
+
+        // Message thread. amount is the steepness of the exponential, logarithmic and S curves. points is a list of
+        // "x y" pairs between 0 and 1 separated by commas, e.g. "0 0, 0.5 0.8, 1 1", for CurveBreakpoints.
+        void set (CurveType type, float amount, const juce::String& points)
+        {
+            amount = std::isfinite (amount) ? juce::jlimit (-maxAmount, maxAmount, amount) : 0.f;
+
+            if (type == mType.load() && amount == mAmount && points == mPoints)
+            {
+                return;
+            }
+
+            mAmount = amount;
+            mPoints = points;
+
+            if (type == CurveLinear)
+            {
+                mType.store (type);
+                return;
+            }
+
+            const auto breakpoints = parseBreakpoints (points);
+
+            for (auto i = 0; i <= tableSize; ++i)
+            {
+                const auto x = static_cast<float> (i) / static_cast<float> (tableSize);
+                const auto y = evaluate (type, amount, breakpoints, x);
+
+                // Whatever the amount, the table never holds a value the MIDI conversion can't take
+                mTable[static_cast<std::size_t> (i)].store (std::isfinite (y) ? juce::jlimit (0.0f, 1.0f, y) : x, std::memory_order_relaxed);
+            }
+
+            mType.store (type);
+        }
+
+        auto type() const { return mType.load(); }
+
+        // Any thread. Values outside 0 - 1 are clamped, except for the linear curve which leaves them alone.
+        float apply (float normalized) const
+        {
+            if (mType.load (std::memory_order_relaxed) == CurveLinear)
+            {
+                return normalized;
+            }
+
+            const auto position = juce::jlimit (0.0f, 1.0f, normalized) * static_cast<float> (tableSize);
+            const auto index = juce::jmin (static_cast<int> (position), tableSize - 1);
+            const auto fraction = position - static_cast<float> (index);
+            const auto a = mTable[static_cast<std::size_t> (index)].load (std::memory_order_relaxed);
+            const auto b = mTable[static_cast<std::size_t> (index + 1)].load (std::memory_order_relaxed);
+
+            return a + (b - a) * fraction;
+        }
+
+    private:
+        struct Breakpoint
+        {
+            float x { 0.f }, y { 0.f };
+        };
+
+        using Breakpoints = std::vector<Breakpoint>;
+
+        static float evaluate (CurveType type, float amount, const Breakpoints& breakpoints, float x)
+        {
+            // A steepness of 0 would divide by 0, and is a straight line anyway
+            const auto k = std::abs (amount) < 1.0e-3f ? 1.0e-3f : amount;
+
+            switch (type)
+            {
+                case CurveExponential:
+                    return std::expm1 (k * x) / std::expm1 (k);
+                case CurveLogarithmic:
+                    return std::log1p (std::expm1 (k) * x) / k;
+                case CurveSCurve:
+                    return 0.5f * (1.0f + std::tanh (k * (x - 0.5f)) / std::tanh (k * 0.5f));
+                case CurveBreakpoints:
+                    return interpolateBreakpoints (breakpoints, x);
+                case CurveLinear:
+                case NumCurveTypes:
+                default:
+                    return x;
+            }
+        }
+
+        static float interpolateBreakpoints (const Breakpoints& breakpoints, float x)
+        {
+            if (breakpoints.empty())
+            {
+                return x;
+            }
+
+            if (x <= breakpoints.front().x)
+            {
+                return breakpoints.front().y;
+            }
+
+            for (std::size_t i = 1; i < breakpoints.size(); ++i)
+            {
+                const auto& from = breakpoints[i - 1];
+                const auto& to = breakpoints[i];
+
+                if (x <= to.x)
+                {
+                    return to.x > from.x ? juce::jmap (x, from.x, to.x, from.y, to.y) : to.y;
+                }
+            }
+
+            return breakpoints.back().y;
+        }
+
+        // Pairs that don't parse are skipped, the rest is sorted by x
+        static Breakpoints parseBreakpoints (const juce::String& points)
+        {
+            Breakpoints breakpoints;
+
+            for (const auto& pair : juce::StringArray::fromTokens (points, ",", ""))
+            {
+                auto values = juce::StringArray::fromTokens (pair.trim(), " ", "");
+                values.removeEmptyStrings();
+
+                if (values.size() != 2)
+                {
+                    DBG ("ResponseCurve: ignoring breakpoint \"" + pair + "\"");
+                    continue;
+                }
+
+                breakpoints.push_back ({ juce::jlimit (0.0f, 1.0f, values[0].getFloatValue()), juce::jlimit (0.0f, 1.0f, values[1].getFloatValue()) });
+            }
+
+            std::sort (breakpoints.begin(), breakpoints.end(), [] (const auto& a, const auto& b) { return a.x < b.x; });
+            return breakpoints;
+        }
+
+        std::array<std::atomic<float>, tableSize + 1> mTable {};
+        std::atomic<CurveType> mType { CurveLinear };
+
+        // Message thread only, to skip rebuilding a curve that didn't change
+        float mAmount { 0.f };
+        juce::String mPoints;
+    };
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace birdhouse
+{
+    /**
+     * @class SLIPDecoder
+     * @brief Incrementally decodes SLIP (RFC 1055) framed packets, as used by OSC 1.1 over stream transports like TCP.
+     *
+     * Bytes may be fed in arbitrary chunks as they arrive from a socket. Frames are reassembled in a fixed buffer
+     * owned by the decoder, so nothing is allocated per frame. Frames that do not fit in MaxFrameSize are dropped.
+     */
+    template <std::size_t MaxFrameSize = 8192>
+    class SLIPDecoder
+    {
+    public:
+        static constexpr std::uint8_t END = 0xC0;
+        static constexpr std::uint8_t ESC = 0xDB;
+        static constexpr std::uint8_t ESC_END = 0xDC;
+        static constexpr std::uint8_t ESC_ESC = 0xDD;
+
+        // Feed a chunk of the stream. onFrame (const std::uint8_t* data, std::size_t size) is called for each completed frame.
+        // The frame data is only valid for the duration of the callback.
+        template <typename FrameCallback>
+        void feed (const void* data, std::size_t numBytes, FrameCallback&& onFrame)
+        {
+            const auto* bytes = static_cast<const std::uint8_t*> (data);
+
+            for (std::size_t i = 0; i < numBytes; ++i)
+            {
+                auto byte = bytes[i];
+
+                if (byte == END)
+                {
+                    // Empty frames are allowed by the spec (a sender may start every packet with END)
+                    if (!mOverflowed && mSize > 0)
+                    {
+                        onFrame (mFrame.data(), mSize);
+                    }
+
+                    if (mOverflowed)
+                    {
+                        mNumDroppedFrames++;
+                    }
+
+                    reset();
+                    continue;
+                }
+
+                if (mEscaped)
+                {
+                    mEscaped = false;
+
+                    // Anything else after ESC is a protocol violation. RFC 1055 suggests keeping the byte as is.
+                    if (byte == ESC_END)
+                    {
+                        byte = END;
+                    }
+                    else if (byte == ESC_ESC)
+                    {
+                        byte = ESC;
+                    }
+                }
+                else if (byte == ESC)
+                {
+                    mEscaped = true;
+                    continue;
+                }
+
+                if (mSize < MaxFrameSize)
+                {
+                    mFrame[mSize++] = byte;
+                }
+                else
+                {
+                    mOverflowed = true;
+                }
+            }
+        }
+
+        // Discard any partially received frame, eg. when a connection is dropped
+        void reset()
+        {
+            mSize = 0;
+            mEscaped = false;
+            mOverflowed = false;
+        }
+
+        auto getNumDroppedFrames() const { return mNumDroppedFrames; }
+
+        static constexpr auto getMaxFrameSize() { return MaxFrameSize; }
+
+    private:
+        std::array<std::uint8_t, MaxFrameSize> mFrame {};
+        std::size_t mSize { 0 };
+        bool mEscaped { false };
+        bool mOverflowed { false };
+        std::size_t mNumDroppedFrames { 0 };
+    };
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "OSCBridgeChannel.h"
+#include <array>
+#include <atomic>
+#include <juce_data_structures/juce_data_structures.h>
+#include <memory>
+#include <vector>
+
+namespace birdhouse
+{
+    /**
+     * @class SceneBank
+     * @brief Preloaded snapshots of every channel's mapping, switched with one atomic pointer store
+     *
+     * Scenes are built and stored on the message thread, ahead of time. Switching only publishes the pointer to a
+     * scene the channels read their mapping from (see OSCBridgeChannelState::setSceneSource), so it can be done from
+     * the OSC dispatch or processBlock in constant time, without parsing or listener callbacks. Scene 0 goes back to
+     * the channels' own settings.
+     *
+     * A stored scene is never changed. Storing over a slot replaces it with a new one, and the old one is deleted
+     * once no thread is reading it anymore (see ActiveScene).
+     */
+    class SceneBank
+    {
+    public:
+        static constexpr int numScenes = 16;
+
+        // Message thread. Makes the channels read their mapping through this bank.
+        void attach (const std::vector<std::shared_ptr<OSCBridgeChannel>>& channels)
+        {
+            for (std::size_t index = 0; index < channels.size(); ++index)
+            {
+                channels[index]->state().setSceneSource (&mActive, static_cast<int> (index));
+            }
+        }
+
+        // Message thread. Stores a scene as number 1 - numScenes.
+        void store (int sceneNumber, Scene scene)
+        {
+            if (sceneNumber < 1 || sceneNumber > numScenes)
+            {
+                DBG ("SceneBank: no scene number " + juce::String (sceneNumber));
+                return;
+            }
+
+            replace (sceneNumber, std::make_unique<const Scene> (std::move (scene)));
+        }
+
+        // Message thread. If the scene is playing, the channels go back to their own settings.
+        void remove (int sceneNumber)
+        {
+            if (sceneNumber < 1 || sceneNumber > numScenes)
+            {
+                return;
+            }
+
+            replace (sceneNumber, nullptr);
+        }
+
+        // Any thread. Returns false if there is no such scene, and the current one stays.
+        bool select (int sceneNumber)
+        {
+            if (sceneNumber == 0)
+            {
+                mActive.scene.store (nullptr);
+                mActiveSceneNumber.store (0);
+                mNumSwitches.fetch_add (1);
+                return true;
+            }
+
+            if (sceneNumber < 1 || sceneNumber > numScenes)
+            {
+                return false;
+            }
+
+            // Registered as a reader from loading the scene until it is active, so it isn't deleted in between
+            mActive.numReaders.fetch_add (1);
+            const auto* scene = mPublished[static_cast<std::size_t> (sceneNumber - 1)].load();
+
+            if (scene != nullptr)
+            {
+                mActive.scene.store (scene);
+                mActiveSceneNumber.store (sceneNumber);
+                mNumSwitches.fetch_add (1);
+            }
+
+            mActive.numReaders.fetch_sub (1);
+            return scene != nullptr;
+        }
+
+        // Message thread
+        const Scene* getScene (int sceneNumber) const
+        {
+            return sceneNumber >= 1 && sceneNumber <= numScenes ? mScenes[static_cast<std::size_t> (sceneNumber - 1)].get() : nullptr;
+        }
+
+        auto getActiveSceneNumber() const { return mActiveSceneNumber.load(); }
+        auto hasScene (int sceneNumber) const { return sceneNumber >= 1 && sceneNumber <= numScenes && mPublished[static_cast<std::size_t> (sceneNumber - 1)].load() != nullptr; }
+
+        // Changes whenever a different scene takes over, for noticing a switch on the audio thread
+        auto getNumSwitches() const { return mNumSwitches.load(); }
+
+        // The channels' own mappings as they are now
+        static Scene capture (const std::vector<std::shared_ptr<OSCBridgeChannel>>& channels)
+        {
+            Scene scene;
+
+            for (auto& channel : channels)
+            {
+                scene.channels.push_back (channel->state().liveMapping());
+            }
+
+            return scene;
+        }
+
+        // Scenes are saved with the plugin state as Scene children, with the same property names as the channels
+        static juce::ValueTree toValueTree (const Scene& scene, int sceneNumber)
+        {
+            juce::ValueTree tree ("Scene");
+            tree.setProperty ("Number", sceneNumber, nullptr);
+
+            for (std::size_t index = 0; index < scene.channels.size(); ++index)
+            {
+                const auto& mapping = scene.channels[index];
+                const auto chanNum = juce::String (index + 1);
+
+                tree.setProperty ("Path" + chanNum, mapping.path, nullptr);
+                tree.setProperty ("InMin" + chanNum, mapping.inMin, nullptr);
+                tree.setProperty ("InMax" + chanNum, mapping.inMax, nullptr);
+                tree.setProperty ("MidiChan" + chanNum, mapping.outChan, nullptr);
+                tree.setProperty ("MidiNum" + chanNum, mapping.outNum, nullptr);
+                tree.setProperty ("MsgType" + chanNum, static_cast<int> (mapping.type), nullptr);
+                tree.setProperty ("Muted" + chanNum, mapping.muted, nullptr);
+                tree.setProperty ("Value" + chanNum, mapping.value, nullptr);
+            }
+
+            return tree;
+        }
+
+        static Scene fromValueTree (const juce::ValueTree& tree, int numChannels)
+        {
+            Scene scene;
+
+            for (auto index = 0; index < numChannels; ++index)
+            {
+                const auto chanNum = juce::String (index + 1);
+                const auto type = juce::jlimit (0, NumMsgTypes - 1, static_cast<int> (tree.getProperty ("MsgType" + chanNum, 0)));
+
+                scene.channels.push_back ({ tree.getProperty ("Path" + chanNum, "/" + chanNum + "/value").toString(),
+                    tree.getProperty ("InMin" + chanNum, 0.0f),
+                    tree.getProperty ("InMax" + chanNum, 1.0f),
+                    tree.getProperty ("MidiChan" + chanNum, 1),
+                    tree.getProperty ("MidiNum" + chanNum, 48 + index),
+                    static_cast<MsgType> (type),
+                    tree.getProperty ("Muted" + chanNum, false),
+                    tree.getProperty ("Value" + chanNum, 0.0f) });
+            }
+
+            return scene;
+        }
+
+    private:
+        void replace (int sceneNumber, std::unique_ptr<const Scene> newScene)
+        {
+            const auto index = static_cast<std::size_t> (sceneNumber - 1);
+            auto oldScene = std::move (mScenes[index]);
+            mScenes[index] = std::move (newScene);
+            mPublished[index].store (mScenes[index].get());
+
+            if (oldScene == nullptr)
+            {
+                return;
+            }
+
+            // If it is playing, the new version takes over right away. A select that read the old one before it was
+            // replaced may still make it active, so this goes on until it is neither active nor being read.
+            do
+            {
+                const Scene* expected = oldScene.get();
+                if (mActive.scene.compare_exchange_strong (expected, mScenes[index].get()))
+                {
+                    mNumSwitches.fetch_add (1);
+
+                    if (mScenes[index] == nullptr)
+                    {
+                        mActiveSceneNumber.store (0);
+                    }
+                }
+
+                waitForReaders();
+            } while (mActive.scene.load() == oldScene.get());
+        }
+
+        // Readers only hold the scene for a few loads, this is a short wait
+        void waitForReaders() const
+        {
+            while (mActive.numReaders.load() != 0)
+            {
+                juce::Thread::yield();
+            }
+        }
+
+        ActiveScene mActive;
+        std::atomic<int> mActiveSceneNumber { 0 };
+        std::atomic<int> mNumSwitches { 0 };
+        std::array<std::atomic<const Scene*>, numScenes> mPublished {};
+
+        // Message thread only
+        std::array<std::unique_ptr<const Scene>, numScenes> mScenes;
+    };
+}
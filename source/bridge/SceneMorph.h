@@ -0,0 +1,132 @@
+#pragma once
+
+#include "OSCBridgeChannel.h"
+#include "PublishedValue.h"
+#include <array>
+#include <atomic>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace birdhouse
+{
+    /**
+     * @class SceneMorph
+     * @brief Crossfades the values and input ranges of every channel between two scenes, with one morph position
+     *
+     * When the two scenes are chosen, on the message thread, their values and ranges are packed into one array of
+     * starting points and one of differences: all values first, then all minimums, then all maximums. Every block
+     * the position moved, processBlock gets start + difference * position for all channels at once, as one vector
+     * copy and one vector multiply-add. Nothing is done in blocks where the position stayed put.
+     *
+     * Like MappingExpression, a new pair of scenes is published with a PublishedValue, so processBlock never reads a
+     * half packed one.
+     */
+    template <int NumChannels>
+    class SceneMorph
+    {
+    public:
+        static constexpr int packedSize = NumChannels * 3;
+
+        // Message thread. Morphs from one scene to the other, or stops morphing if either is nullptr.
+        void setScenes (const Scene* from, const Scene* to)
+        {
+            mPacked.publishWith ([from, to] (Packed& packed) {
+                packed.enabled = from != nullptr && to != nullptr;
+
+                if (!packed.enabled)
+                {
+                    return;
+                }
+
+                for (auto index = 0; index < NumChannels; ++index)
+                {
+                    const auto a = mappingAt (*from, index);
+                    const auto b = mappingAt (*to, index);
+
+                    pack (packed, index, a.value, b.value);
+                    pack (packed, NumChannels + index, a.inMin, b.inMin);
+                    pack (packed, 2 * NumChannels + index, a.inMax, b.inMax);
+                }
+            });
+
+            mGeneration.fetch_add (1);
+        }
+
+        // Any thread, 0 is the first scene and 1 the second
+        void setPosition (float newPosition) { mPosition.store (juce::jlimit (0.0f, 1.0f, newPosition)); }
+        auto getPosition() const { return mPosition.load(); }
+
+        // Audio thread, once per block. If the position or the scenes changed, calls
+        // apply (int channel, float value, float inMin, float inMax) for every channel. When morphing stops, calls
+        // stop (int channel) for every channel once.
+        template <typename ApplyCallback, typename StopCallback>
+        bool process (ApplyCallback&& apply, StopCallback&& stop)
+        {
+            const auto generation = mGeneration.load();
+            const auto position = mPosition.load (std::memory_order_relaxed);
+
+            if (position == mLastPosition && generation == mLastGeneration)
+            {
+                return false;
+            }
+
+            {
+                const auto packed = mPacked.read();
+
+                if (!packed->enabled)
+                {
+                    for (auto index = 0; mWasEnabled && index < NumChannels; ++index)
+                    {
+                        stop (index);
+                    }
+
+                    mWasEnabled = false;
+                    mLastGeneration = generation;
+                    return false;
+                }
+
+                juce::FloatVectorOperations::copy (mMorphed.data(), packed->start.data(), packedSize);
+                juce::FloatVectorOperations::addWithMultiply (mMorphed.data(), packed->delta.data(), position, packedSize);
+            }
+
+            mWasEnabled = true;
+            mLastPosition = position;
+            mLastGeneration = generation;
+
+            for (std::size_t index = 0; index < NumChannels; ++index)
+            {
+                apply (static_cast<int> (index), mMorphed[index], mMorphed[NumChannels + index], mMorphed[2 * NumChannels + index]);
+            }
+
+            return true;
+        }
+
+    private:
+        struct Packed
+        {
+            std::array<float, packedSize> start {}, delta {};
+            bool enabled { false };
+        };
+
+        // A scene with fewer channels has the default mapping for the rest
+        static ChannelMapping mappingAt (const Scene& scene, int index)
+        {
+            return static_cast<std::size_t> (index) < scene.channels.size() ? scene.channels[static_cast<std::size_t> (index)] : ChannelMapping {};
+        }
+
+        static void pack (Packed& packed, int index, float from, float to)
+        {
+            packed.start[static_cast<std::size_t> (index)] = from;
+            packed.delta[static_cast<std::size_t> (index)] = to - from;
+        }
+
+        PublishedValue<Packed> mPacked;
+        std::atomic<int> mGeneration { 0 };
+        std::atomic<float> mPosition { 0.f };
+
+        // Audio thread only
+        std::array<float, packedSize> mMorphed {};
+        float mLastPosition { -1.f };
+        int mLastGeneration { -1 };
+        bool mWasEnabled { false };
+    };
+}
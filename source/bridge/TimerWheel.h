@@ -0,0 +1,260 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <juce_core/juce_core.h>
+#include <limits>
+
+namespace birdhouse
+{
+    /**
+     * @class TimerWheel
+     * @brief Hierarchical timer wheel with sample resolution and a preallocated pool of timers
+     *
+     * Four levels of 64 slots cover 2^24 samples (almost 6 minutes at 48 kHz); anything further away waits in an
+     * overflow list. Scheduling and firing are O(1) per timer, timers are moved down a level at most once per level.
+     * Advancing jumps from one occupied slot to the next with the occupancy bitmaps, so a block costs the number of
+     * slots that fire or move down, not its length. Everything lives in fixed arrays, so it can be used on the audio
+     * thread.
+     */
+    template <typename Payload, int Capacity = 4096>
+    class TimerWheel
+    {
+    public:
+        static_assert (std::is_trivially_copyable_v<Payload>);
+
+        TimerWheel()
+        {
+            clear();
+        }
+
+        // Fire the payload delaySamples from now. Returns false if the pool is full.
+        bool schedule (juce::int64 delaySamples, const Payload& payload)
+        {
+            if (mFreeList == none)
+            {
+                return false;
+            }
+
+            const auto index = mFreeList;
+            auto& timer = mTimers[static_cast<std::size_t> (index)];
+            mFreeList = timer.next;
+
+            timer.payload = payload;
+            timer.expiry = mNow + juce::jmax (juce::int64 { 0 }, delaySamples);
+            insert (index);
+            ++mNumScheduled;
+            return true;
+        }
+
+        // Moves time forward by numSamples, calling onExpired (const Payload&, int sampleOffset) for every timer due
+        template <typename ExpiredCallback>
+        void advance (int numSamples, ExpiredCallback&& onExpired)
+        {
+            auto sample = 0;
+
+            while (sample < numSamples)
+            {
+                if (mNumScheduled == 0)
+                {
+                    mNow += numSamples - sample;
+                    return;
+                }
+
+                if ((mNow & slotMask) == 0)
+                {
+                    cascade (1);
+                }
+
+                const auto slot = static_cast<std::size_t> (mNow & slotMask);
+                auto index = mSlots[0][slot];
+                mSlots[0][slot] = none;
+                mOccupied[0] &= ~(juce::uint64 { 1 } << slot);
+
+                while (index != none)
+                {
+                    auto& timer = mTimers[static_cast<std::size_t> (index)];
+                    const auto next = timer.next;
+
+                    onExpired (timer.payload, sample);
+
+                    timer.next = mFreeList;
+                    mFreeList = index;
+                    --mNumScheduled;
+                    index = next;
+                }
+
+                // Nothing happens until then
+                const auto step = static_cast<int> (juce::jmin (nextEventTime() - mNow, static_cast<juce::int64> (numSamples - sample)));
+                mNow += step;
+                sample += step;
+            }
+        }
+
+        // Multiplies the time left on every pending timer by ratio, e.g. by the new sample rate over the old one
+        void rescale (double ratio)
+        {
+            auto pending = mOverflow;
+            mOverflow = none;
+
+            for (std::size_t level = 0; level < mSlots.size(); ++level)
+            {
+                for (auto& head : mSlots[level])
+                {
+                    while (head != none)
+                    {
+                        const auto index = head;
+                        head = mTimers[static_cast<std::size_t> (index)].next;
+                        mTimers[static_cast<std::size_t> (index)].next = pending;
+                        pending = index;
+                    }
+                }
+
+                mOccupied[level] = 0;
+            }
+
+            while (pending != none)
+            {
+                auto& timer = mTimers[static_cast<std::size_t> (pending)];
+                const auto next = timer.next;
+
+                timer.expiry = mNow + static_cast<juce::int64> (std::llround (static_cast<double> (timer.expiry - mNow) * ratio));
+                insert (pending);
+                pending = next;
+            }
+        }
+
+        void clear()
+        {
+            for (auto& level : mSlots)
+            {
+                level.fill (none);
+            }
+
+            mOccupied.fill (0);
+            mOverflow = none;
+
+            for (auto i = 0; i < Capacity; ++i)
+            {
+                mTimers[static_cast<std::size_t> (i)].next = i + 1 < Capacity ? i + 1 : none;
+            }
+
+            mFreeList = 0;
+            mNumScheduled = 0;
+        }
+
+        auto getNumScheduled() const { return mNumScheduled; }
+        auto getTime() const { return mNow; }
+
+    private:
+        static constexpr int none = -1;
+        static constexpr int numLevels = 4;
+        static constexpr int bitsPerLevel = 6;
+        static constexpr juce::int64 slotMask = (1 << bitsPerLevel) - 1;
+
+        struct Timer
+        {
+            Payload payload {};
+            juce::int64 expiry { 0 };
+            int next { none };
+        };
+
+        // A timer goes on the lowest level where it shares its parent slot with the current time, so the slot it
+        // lands in is always reached before the parent slot moves on
+        void insert (int index)
+        {
+            auto& timer = mTimers[static_cast<std::size_t> (index)];
+
+            for (auto level = 0; level < numLevels; ++level)
+            {
+                const auto parentShift = bitsPerLevel * (level + 1);
+
+                if ((timer.expiry >> parentShift) == (mNow >> parentShift))
+                {
+                    const auto slot = static_cast<std::size_t> ((timer.expiry >> (bitsPerLevel * level)) & slotMask);
+                    timer.next = mSlots[static_cast<std::size_t> (level)][slot];
+                    mSlots[static_cast<std::size_t> (level)][slot] = index;
+                    mOccupied[static_cast<std::size_t> (level)] |= juce::uint64 { 1 } << slot;
+                    return;
+                }
+            }
+
+            timer.next = mOverflow;
+            mOverflow = index;
+        }
+
+        // The first time after now at which a level 0 slot fires or a slot of a higher level moves down. Slots at or
+        // before the current one of their level are always empty, see insert.
+        juce::int64 nextEventTime() const
+        {
+            auto next = std::numeric_limits<juce::int64>::max();
+
+            for (auto level = 0; level < numLevels; ++level)
+            {
+                const auto shift = bitsPerLevel * level;
+                const auto slot = (mNow >> shift) & slotMask;
+                const auto later = slot == slotMask ? 0 : mOccupied[static_cast<std::size_t> (level)] & (~juce::uint64 { 0 } << (slot + 1));
+
+                if (later != 0)
+                {
+                    const auto roundStart = (mNow >> (shift + bitsPerLevel)) << (shift + bitsPerLevel);
+                    next = juce::jmin (next, roundStart + (static_cast<juce::int64> (std::countr_zero (later)) << shift));
+                }
+            }
+
+            // The overflow list moves down when the top level wraps around
+            if (mOverflow != none)
+            {
+                const auto topShift = bitsPerLevel * numLevels;
+                next = juce::jmin (next, ((mNow >> topShift) + 1) << topShift);
+            }
+
+            return next;
+        }
+
+        // Called when the lower level has wrapped around, moves the timers of the current slot down
+        void cascade (int level)
+        {
+            auto index = none;
+
+            if (level == numLevels)
+            {
+                index = mOverflow;
+                mOverflow = none;
+            }
+            else
+            {
+                const auto slot = static_cast<std::size_t> ((mNow >> (bitsPerLevel * level)) & slotMask);
+
+                if (slot == 0)
+                {
+                    cascade (level + 1);
+                }
+
+                if ((mOccupied[static_cast<std::size_t> (level)] & (juce::uint64 { 1 } << slot)) == 0)
+                {
+                    return;
+                }
+
+                index = mSlots[static_cast<std::size_t> (level)][slot];
+                mSlots[static_cast<std::size_t> (level)][slot] = none;
+                mOccupied[static_cast<std::size_t> (level)] &= ~(juce::uint64 { 1 } << slot);
+            }
+
+            while (index != none)
+            {
+                const auto next = mTimers[static_cast<std::size_t> (index)].next;
+                insert (index);
+                index = next;
+            }
+        }
+
+        std::array<Timer, static_cast<std::size_t> (Capacity)> mTimers {};
+        std::array<std::array<int, 1 << bitsPerLevel>, numLevels> mSlots {};
+        std::array<juce::uint64, numLevels> mOccupied {};
+        int mOverflow { none };
+        int mFreeList { 0 };
+        int mNumScheduled { 0 };
+        juce::int64 mNow { 0 };
+    };
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "EventFifo.h"
+#include <array>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+
+namespace birdhouse
+{
+    namespace ump
+    {
+        // A MIDI 2.0 channel voice message (UMP message type 0x4), two 32 bit words
+        struct Packet64
+        {
+            juce::uint32 word0 { 0 }, word1 { 0 };
+        };
+
+        static_assert (std::is_trivially_copyable_v<Packet64> && sizeof (Packet64) == 8);
+
+        enum Opcode : juce::uint32 {
+            RegisteredController = 0x2,
+            AssignableController = 0x3,
+            NoteOff = 0x8,
+            NoteOn = 0x9,
+            PolyPressure = 0xA,
+            ControlChange = 0xB,
+            ProgramChange = 0xC,
+            ChannelPressure = 0xD,
+            PitchBend = 0xE
+        };
+
+        // Full scale 32 bit value for a normalized float
+        inline juce::uint32 toUint32 (float normalizedValue)
+        {
+            return static_cast<juce::uint32> (static_cast<double> (juce::jlimit (0.0f, 1.0f, normalizedValue)) * 4294967295.0);
+        }
+
+        // midiChannel is 1 - 16 like everywhere else in the bridge, all messages go to group 0
+        inline Packet64 makeChannelVoice (Opcode opcode, int midiChannel, int byte3, int byte4, juce::uint32 data)
+        {
+            const auto channel = static_cast<juce::uint32> (juce::jlimit (1, 16, midiChannel) - 1);
+            return { (0x4u << 28) | (static_cast<juce::uint32> (opcode) << 20) | (channel << 16)
+                         | ((static_cast<juce::uint32> (byte3) & 0x7f) << 8) | (static_cast<juce::uint32> (byte4) & 0x7f),
+                data };
+        }
+
+        inline Packet64 makeControlChange (int midiChannel, int controller, juce::uint32 value)
+        {
+            return makeChannelVoice (ControlChange, midiChannel, controller, 0, value);
+        }
+
+        inline Packet64 makeNoteOn (int midiChannel, int note, juce::uint16 velocity)
+        {
+            return makeChannelVoice (NoteOn, midiChannel, note, 0, static_cast<juce::uint32> (velocity) << 16);
+        }
+
+        inline Packet64 makeNoteOff (int midiChannel, int note, juce::uint16 velocity)
+        {
+            return makeChannelVoice (NoteOff, midiChannel, note, 0, static_cast<juce::uint32> (velocity) << 16);
+        }
+
+        inline Packet64 makePitchBend (int midiChannel, juce::uint32 value)
+        {
+            return makeChannelVoice (PitchBend, midiChannel, 0, 0, value);
+        }
+
+        inline Packet64 makePolyPressure (int midiChannel, int note, juce::uint32 value)
+        {
+            return makeChannelVoice (PolyPressure, midiChannel, note, 0, value);
+        }
+
+        inline Packet64 makeChannelPressure (int midiChannel, juce::uint32 value)
+        {
+            return makeChannelVoice (ChannelPressure, midiChannel, 0, 0, value);
+        }
+
+        // Without the bank valid option, the program number is all there is
+        inline Packet64 makeProgramChange (int midiChannel, int program)
+        {
+            return makeChannelVoice (ProgramChange, midiChannel, 0, 0, (static_cast<juce::uint32> (program) & 0x7f) << 24);
+        }
+
+        // RPN (registered) and NRPN (assignable) controllers carry their 14 bit parameter number as bank and index
+        inline Packet64 makeParameter (int midiChannel, int parameter, bool registered, juce::uint32 value)
+        {
+            return makeChannelVoice (registered ? RegisteredController : AssignableController, midiChannel, parameter >> 7, parameter, value);
+        }
+
+        // Written by the OSC dispatch and read by the audio thread
+        template <int Capacity = 1024>
+        using PacketFifo = EventFifo<Packet64, Capacity>;
+
+        /**
+         * @class Midi1Downconverter
+         * @brief Turns MIDI 2.0 channel voice packets into MIDI 1.0 bytes, for hosts that only take MIDI 1.0
+         *
+         * Packets are converted in batches: first every field of every packet is computed with straight line code
+         * over plain arrays, which the compiler vectorizes, then the resulting bytes are handed out one message at a
+         * time. Values are scaled down by dropping the low bits, as the MIDI 2.0 translation rules specify.
+         */
+        class Midi1Downconverter
+        {
+        public:
+            static constexpr int batchSize = 64;
+
+            // onMessage (const juce::uint8* bytes, int numBytes) is called once per MIDI 1.0 message
+            template <typename MessageCallback>
+            void convert (const Packet64* packets, int numPackets, MessageCallback&& onMessage)
+            {
+                for (auto start = 0; start < numPackets; start += batchSize)
+                {
+                    const auto count = juce::jmin (batchSize, numPackets - start);
+                    computeFields (packets + start, count);
+                    emitMessages (count, onMessage);
+                }
+            }
+
+        private:
+            void computeFields (const Packet64* packets, int count)
+            {
+                for (auto i = 0; i < count; ++i)
+                {
+                    const auto word0 = packets[i].word0;
+                    const auto word1 = packets[i].word1;
+                    const auto opcode = (word0 >> 20) & 0xf;
+                    const auto value7 = word1 >> 25;
+                    const auto bend14 = word1 >> 18;
+                    const auto isBend = opcode == PitchBend;
+                    const auto isProgram = opcode == ProgramChange;
+                    const auto isChannelPressure = opcode == ChannelPressure;
+
+                    // A MIDI 1.0 note on with velocity 0 would be a note off
+                    const auto data2 = opcode == NoteOn ? juce::jmax (1u, value7) : value7;
+                    const auto index = isProgram ? (word1 >> 24) & 0x7f : (isChannelPressure ? value7 : (word0 >> 8) & 0x7f);
+
+                    mOpcode[static_cast<std::size_t> (i)] = static_cast<juce::uint8> (opcode);
+                    mStatus[static_cast<std::size_t> (i)] = static_cast<juce::uint8> ((opcode << 4) | ((word0 >> 16) & 0xf));
+                    mBank[static_cast<std::size_t> (i)] = static_cast<juce::uint8> ((word0 >> 8) & 0x7f);
+                    mIndex[static_cast<std::size_t> (i)] = static_cast<juce::uint8> (isBend ? bend14 & 0x7f : index);
+                    mData2[static_cast<std::size_t> (i)] = static_cast<juce::uint8> (isBend ? bend14 >> 7 : data2);
+                    mParameterIndex[static_cast<std::size_t> (i)] = static_cast<juce::uint8> (word0 & 0x7f);
+                    mValueLsb[static_cast<std::size_t> (i)] = static_cast<juce::uint8> ((word1 >> 18) & 0x7f);
+                }
+            }
+
+            template <typename MessageCallback>
+            void emitMessages (int count, MessageCallback& onMessage)
+            {
+                for (auto index = 0; index < count; ++index)
+                {
+                    const auto i = static_cast<std::size_t> (index);
+                    const auto opcode = mOpcode[i];
+
+                    if (opcode == RegisteredController || opcode == AssignableController)
+                    {
+                        // Parameter select followed by 14 bit data entry
+                        const auto channelStatus = static_cast<juce::uint8> (0xb0 | (mStatus[i] & 0x0f));
+                        const auto isRegistered = opcode == RegisteredController;
+                        const juce::uint8 messages[4][3] = {
+                            { channelStatus, static_cast<juce::uint8> (isRegistered ? 101 : 99), mBank[i] },
+                            { channelStatus, static_cast<juce::uint8> (isRegistered ? 100 : 98), mParameterIndex[i] },
+                            { channelStatus, 6, mData2[i] },
+                            { channelStatus, 38, mValueLsb[i] },
+                        };
+
+                        for (auto& message : messages)
+                        {
+                            onMessage (message, 3);
+                        }
+                    }
+                    else if (opcode == NoteOff || opcode == NoteOn || opcode == PolyPressure || opcode == ControlChange || opcode == PitchBend)
+                    {
+                        const juce::uint8 message[3] = { mStatus[i], mIndex[i], mData2[i] };
+                        onMessage (message, 3);
+                    }
+                    else if (opcode == ProgramChange || opcode == ChannelPressure)
+                    {
+                        const juce::uint8 message[2] = { mStatus[i], mIndex[i] };
+                        onMessage (message, 2);
+                    }
+                }
+            }
+
+            std::array<juce::uint8, batchSize> mOpcode {}, mStatus {}, mBank {}, mIndex {}, mData2 {}, mParameterIndex {}, mValueLsb {};
+        };
+    }
+}
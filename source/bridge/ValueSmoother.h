@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <juce_core/juce_core.h>
+
+namespace birdhouse
+{
+    enum SmoothingMode {
+        SmoothingOff,
+        SmoothingOnePole,
+        SmoothingSlew,
+        SmoothingMedian,
+        NumSmoothingModes
+    };
+
+    /**
+     * @class ValueSmoother
+     * @brief Takes the jitter out of a channel's values as they arrive, before they are converted to MIDI
+     *
+     * One pole lowpass and slew limit follow the time between messages, so they behave the same however fast a sensor
+     * sends. Median of 3 drops single spikes without any lag on steady changes. Every mode is a few multiplies per
+     * message on a fixed amount of memory. As nothing runs between messages, they suit senders that stream
+     * continuously: the output only moves when a message arrives. OSC thread only.
+     */
+    class ValueSmoother
+    {
+    public:
+        // Forget the history, the next value is taken as is
+        void reset() { mInitialised = false; }
+
+        // timeMs is the time constant of the one pole and the time the slew limit takes to cross the whole range
+        float process (float value, SmoothingMode mode, float timeMs, double nowMs)
+        {
+            if (!mInitialised || mode != mMode)
+            {
+                mInitialised = true;
+                mMode = mode;
+                mOutput = value;
+                mHistory.fill (value);
+                mLastTimeMs = nowMs;
+                return value;
+            }
+
+            const auto elapsedMs = static_cast<float> (juce::jmax (0.0, nowMs - mLastTimeMs));
+            mLastTimeMs = nowMs;
+
+            switch (mode)
+            {
+                case SmoothingOnePole:
+                    // RC lowpass with a coefficient of dt / (RC + dt), which needs no exp per message
+                    mOutput += (value - mOutput) * (timeMs > 0.f ? elapsedMs / (timeMs + elapsedMs) : 1.f);
+                    break;
+                case SmoothingSlew:
+                {
+                    const auto maxChange = timeMs > 0.f ? elapsedMs / timeMs : 1.f;
+                    mOutput += juce::jlimit (-maxChange, maxChange, value - mOutput);
+                    break;
+                }
+                case SmoothingMedian:
+                    mHistory[mNextIndex] = value;
+                    mNextIndex = (mNextIndex + 1) % mHistory.size();
+                    mOutput = medianOf3 (mHistory[0], mHistory[1], mHistory[2]);
+                    break;
+                case SmoothingOff:
+                case NumSmoothingModes:
+                default:
+                    mOutput = value;
+                    break;
+            }
+
+            return mOutput;
+        }
+
+    private:
+        static float medianOf3 (float a, float b, float c)
+        {
+            return juce::jmax (juce::jmin (a, b), juce::jmin (juce::jmax (a, b), c));
+        }
+
+        std::array<float, 3> mHistory {};
+        std::size_t mNextIndex { 0 };
+        double mLastTimeMs { 0.0 };
+        float mOutput { 0.f };
+        SmoothingMode mMode { SmoothingOff };
+        bool mInitialised { false };
+    };
+}
@@ -137,6 +137,17 @@ namespace birdhouse
                 portLayout.add (std::make_unique<juce::AudioParameterBool> (mutedParamID, mutedParameterName, mutedDefaultValue));
             }
 
+            // Value parameters come after all the others, so hosts that address parameters by index keep finding the
+            // existing ones where they were
+            for (auto chanNum = 1u; chanNum <= NumBridgeChans; chanNum++)
+            {
+                // Add Value parameter. This is an output: channels with automation output write their value to it.
+                auto valueParamID = juce::String ("Value") + juce::String (chanNum);
+                auto valueParameterName = juce::String ("Value") + juce::String (chanNum);
+                auto valueDefaultValue = 0.f;
+                portLayout.add (std::make_unique<juce::AudioParameterFloat> (valueParamID, valueParameterName, 0.f, 1.f, valueDefaultValue));
+            }
+
             return portLayout;
         }
     };
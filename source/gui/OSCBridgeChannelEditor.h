@@ -311,6 +311,13 @@ private:
         outputMsgTypeComboBox.addItem ("CC", birdhouse::MsgType::MidiCC + 1);
         outputMsgTypeComboBox.addItem ("Note", birdhouse::MsgType::MidiNote + 1);
         outputMsgTypeComboBox.addItem ("Bend", birdhouse::MsgType::MidiBend + 1);
+        outputMsgTypeComboBox.addItem ("CC 14-bit", birdhouse::MsgType::MidiCC14 + 1);
+        outputMsgTypeComboBox.addItem ("NRPN", birdhouse::MsgType::MidiNRPN + 1);
+        outputMsgTypeComboBox.addItem ("RPN", birdhouse::MsgType::MidiRPN + 1);
+        outputMsgTypeComboBox.addItem ("MPE", birdhouse::MsgType::MidiMPE + 1);
+        outputMsgTypeComboBox.addItem ("Poly AT", birdhouse::MsgType::MidiPolyPressure + 1);
+        outputMsgTypeComboBox.addItem ("Chan AT", birdhouse::MsgType::MidiChannelPressure + 1);
+        outputMsgTypeComboBox.addItem ("Program", birdhouse::MsgType::MidiProgramChange + 1);
         outputMsgTypeComboBox.setSelectedItemIndex (birdhouse::MsgType::MidiNote, juce::dontSendNotification);
         addAndMakeVisible (outputMsgTypeComboBox);
 
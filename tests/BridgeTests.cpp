@@ -0,0 +1,1203 @@
+#include "bridge/ControlSignalOutput.h"
+#include "bridge/DirectMidiOutput.h"
+#include "bridge/HostParameterOutput.h"
+#include "bridge/MidiRateLimiter.h"
+#include "bridge/MidiThru.h"
+#include "bridge/NoteOffScheduler.h"
+#include "bridge/OSCBridgeManager.h"
+#include "bridge/OSCInMemoryTransport.h"
+#include "bridge/OSCPacketParser.h"
+#include "bridge/SceneBank.h"
+#include "bridge/SLIPDecoder.h"
+#include "bridge/SceneMorph.h"
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    // "/1/value" with a single float argument of 0.5
+    constexpr char valuePacket[] = { '/', '1', '/', 'v', 'a', 'l', 'u', 'e', 0, 0, 0, 0, ',', 'f', 0, 0, 0x3f, 0, 0, 0 };
+
+    // Gives the receive threads up to two seconds to get to what was sent
+    template <typename Condition>
+    bool waitFor (Condition&& condition)
+    {
+        for (auto attempt = 0; attempt < 2000 && !condition(); ++attempt)
+        {
+            juce::Thread::sleep (1);
+        }
+
+        return condition();
+    }
+
+    // The channel got the 0.5 of valuePacket, possibly still on its way from a receive thread
+    void checkReceivedValuePacket (birdhouse::OSCBridgeChannel& channel)
+    {
+        juce::MidiBuffer midi;
+        waitFor ([&] {
+            channel.appendMessagesTo (midi);
+            return !midi.isEmpty();
+        });
+
+        REQUIRE (midi.getNumEvents() == 1);
+        CHECK ((*midi.begin()).getMessage().getControllerValue() == 63);
+    }
+}
+
+TEST_CASE ("Bridge dispatch", "[bridge]")
+{
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 48, birdhouse::MidiCC);
+    birdhouse::OSCBridgeManager manager ({ channel });
+    auto& transport = manager.addTransport<birdhouse::OSCInMemoryTransport>();
+
+    REQUIRE (manager.startListening (0));
+
+    SECTION ("matching message produces MIDI")
+    {
+        // "/1/value" with a single float argument of 0.5
+        const char packet[] = { '/', '1', '/', 'v', 'a', 'l', 'u', 'e', 0, 0, 0, 0, ',', 'f', 0, 0, 0x3f, 0, 0, 0 };
+        CHECK (transport.inject (packet, sizeof (packet)));
+
+        juce::MidiBuffer midi;
+        channel->appendMessagesTo (midi);
+        REQUIRE (midi.getNumEvents() == 1);
+
+        const auto message = (*midi.begin()).getMessage();
+        CHECK (message.isController());
+        CHECK (message.getControllerNumber() == 48);
+        CHECK (message.getControllerValue() == 63);
+    }
+
+    SECTION ("malformed packet is rejected")
+    {
+        const char packet[] = { '/', '1', '/' };
+        CHECK_FALSE (transport.inject (packet, sizeof (packet)));
+
+        juce::MidiBuffer midi;
+        channel->appendMessagesTo (midi);
+        CHECK (midi.getNumEvents() == 0);
+    }
+
+    manager.stopListening();
+    CHECK_FALSE (transport.isConnected());
+}
+
+TEST_CASE ("Blobs with a bad length are rejected", "[bridge]")
+{
+    auto numMessages = 0;
+    auto count = [&numMessages] (const juce::OSCMessage&) { numMessages++; };
+
+    // "/b" with one blob argument, its length in bytes 8 - 11 followed by 4 bytes of data
+    char packet[] = { '/', 'b', 0, 0, ',', 'b', 0, 0, 0, 0, 0, 4, 1, 2, 3, 4 };
+    CHECK (birdhouse::OSCPacketParser::parse (packet, sizeof (packet), count));
+    CHECK (numMessages == 1);
+
+    SECTION ("negative length")
+    {
+        packet[8] = packet[9] = packet[10] = packet[11] = static_cast<char> (0xff);
+        CHECK_FALSE (birdhouse::OSCPacketParser::parse (packet, sizeof (packet), count));
+    }
+
+    SECTION ("longer than the packet")
+    {
+        packet[11] = 5;
+        CHECK_FALSE (birdhouse::OSCPacketParser::parse (packet, sizeof (packet), count));
+    }
+
+    CHECK (numMessages == 1);
+}
+
+#if BIRDHOUSE_HAS_SHARED_RING
+TEST_CASE ("Corrupt shared memory rings are dropped", "[bridge]")
+{
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 48, birdhouse::MidiCC);
+    birdhouse::OSCBridgeManager manager ({ channel });
+    manager.addTransport<birdhouse::OSCSharedMemoryReceiver>();
+
+    constexpr auto port = 47811;
+    REQUIRE (manager.startListening (port));
+
+    auto* ring = birdhouse_ring_attach (port);
+    REQUIRE (ring != nullptr);
+
+    const auto isDrained = [ring] { return __atomic_load_n (&ring->read_pos, __ATOMIC_ACQUIRE) == __atomic_load_n (&ring->write_pos, __ATOMIC_ACQUIRE); };
+
+    // Writes the records by hand, the way a broken producer would
+    const auto writeRaw = [ring] (std::initializer_list<std::uint32_t> words) {
+        auto offset = std::size_t { 0 };
+        for (const auto word : words)
+        {
+            std::memcpy (ring->data + offset, &word, sizeof (word));
+            offset += sizeof (word);
+        }
+
+        __atomic_store_n (&ring->write_pos, ring->write_pos + offset, __ATOMIC_SEQ_CST);
+        birdhouse_ring_wake_consumer (ring);
+    };
+
+    SECTION ("a wrap marker at the start of the data")
+    {
+        // Would skip a whole lap on every pass and never catch up with the write position
+        writeRaw ({ BIRDHOUSE_RING_WRAP, 0 });
+    }
+
+    SECTION ("a wrap marker past the write position")
+    {
+        // An 8 byte record, then a wrap marker without the skipped space being written
+        writeRaw ({ 8, 0, 0, BIRDHOUSE_RING_WRAP });
+    }
+
+    REQUIRE (waitFor (isDrained));
+
+    // The ring is back in step, a proper packet after the garbage still arrives
+    REQUIRE (birdhouse_ring_write (ring, valuePacket, sizeof (valuePacket)) == 1);
+    REQUIRE (waitFor (isDrained));
+    checkReceivedValuePacket (*channel);
+
+    birdhouse_ring_detach (ring);
+    manager.stopListening();
+}
+
+TEST_CASE ("OSC arrives through the shared memory ring", "[bridge]")
+{
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 48, birdhouse::MidiCC);
+    birdhouse::OSCBridgeManager manager ({ channel });
+    manager.addTransport<birdhouse::OSCSharedMemoryReceiver>();
+
+    constexpr auto port = 47813;
+    REQUIRE (manager.startListening (port));
+
+    auto* ring = birdhouse_ring_attach (port);
+    REQUIRE (ring != nullptr);
+
+    const auto isDrained = [ring] { return __atomic_load_n (&ring->read_pos, __ATOMIC_ACQUIRE) == __atomic_load_n (&ring->write_pos, __ATOMIC_ACQUIRE); };
+
+    SECTION ("one packet")
+    {
+        REQUIRE (birdhouse_ring_write (ring, valuePacket, sizeof (valuePacket)) == 1);
+        checkReceivedValuePacket (*channel);
+    }
+
+    SECTION ("after a wrap marker")
+    {
+        // Three records that leave 16 bytes at the end, too few for the packet's 24 byte record. They aren't OSC, so
+        // they are dropped.
+        const std::vector<char> filler ((BIRDHOUSE_RING_CAPACITY - 16) / 3 - 4, 0);
+        for (auto i = 0; i < 3; ++i)
+        {
+            REQUIRE (birdhouse_ring_write (ring, filler.data(), static_cast<std::uint32_t> (filler.size())) == 1);
+            REQUIRE (waitFor (isDrained));
+        }
+
+        REQUIRE (ring->write_pos == BIRDHOUSE_RING_CAPACITY - 16);
+
+        REQUIRE (birdhouse_ring_write (ring, valuePacket, sizeof (valuePacket)) == 1);
+        CHECK (ring->write_pos == BIRDHOUSE_RING_CAPACITY + 24);
+        checkReceivedValuePacket (*channel);
+        CHECK (waitFor (isDrained));
+    }
+
+    SECTION ("packets that can never fit are refused")
+    {
+        CHECK (birdhouse_ring_write (ring, valuePacket, 0xffffffff) == -1);
+        CHECK (ring->write_pos == 0);
+    }
+
+    birdhouse_ring_detach (ring);
+    manager.stopListening();
+}
+#endif
+
+TEST_CASE ("SLIP frames are reassembled from the stream", "[bridge]")
+{
+    using Frame = std::vector<std::uint8_t>;
+    using Decoder = birdhouse::SLIPDecoder<8>;
+
+    Decoder decoder;
+    std::vector<Frame> frames;
+    const auto feed = [&decoder, &frames] (std::initializer_list<std::uint8_t> bytes) {
+        const std::vector<std::uint8_t> chunk (bytes);
+        decoder.feed (chunk.data(), chunk.size(), [&frames] (const std::uint8_t* data, std::size_t size) { frames.emplace_back (data, data + size); });
+    };
+
+    SECTION ("across chunks")
+    {
+        feed ({ Decoder::END, 1, 2 });
+        CHECK (frames.empty());
+
+        feed ({ 3, Decoder::END, 4 });
+        feed ({ Decoder::END });
+        REQUIRE (frames.size() == 2);
+        CHECK (frames[0] == Frame { 1, 2, 3 });
+        CHECK (frames[1] == Frame { 4 });
+    }
+
+    SECTION ("escaped END and ESC, also split between chunks")
+    {
+        feed ({ Decoder::ESC, Decoder::ESC_END, Decoder::ESC });
+        feed ({ Decoder::ESC_ESC, Decoder::END });
+        REQUIRE (frames.size() == 1);
+        CHECK (frames[0] == Frame { Decoder::END, Decoder::ESC });
+    }
+
+    SECTION ("an invalid escape keeps the byte")
+    {
+        feed ({ Decoder::ESC, 5, 6, Decoder::END });
+        REQUIRE (frames.size() == 1);
+        CHECK (frames[0] == Frame { 5, 6 });
+    }
+
+    SECTION ("empty frames are skipped")
+    {
+        feed ({ Decoder::END, Decoder::END, Decoder::END, 7, Decoder::END });
+        REQUIRE (frames.size() == 1);
+        CHECK (frames[0] == Frame { 7 });
+        CHECK (decoder.getNumDroppedFrames() == 0);
+    }
+
+    SECTION ("a frame that doesn't fit is dropped")
+    {
+        feed ({ 1, 2, 3, 4, 5, 6, 7, 8, 9, Decoder::END });
+        CHECK (frames.empty());
+        CHECK (decoder.getNumDroppedFrames() == 1);
+
+        // The next frame starts clean
+        feed ({ 1, 2, 3, 4, 5, 6, 7, 8, Decoder::END });
+        REQUIRE (frames.size() == 1);
+        CHECK (frames[0].size() == 8);
+        CHECK (decoder.getNumDroppedFrames() == 1);
+    }
+}
+
+#if BIRDHOUSE_HAS_UNIX_SOCKETS
+TEST_CASE ("OSC arrives over the Unix domain socket", "[bridge]")
+{
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 48, birdhouse::MidiCC);
+    birdhouse::OSCBridgeManager manager ({ channel });
+    manager.addTransport<birdhouse::OSCUnixSocketReceiver>();
+
+    constexpr auto port = 47812;
+    REQUIRE (manager.startListening (port));
+
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    std::strncpy (address.sun_path, birdhouse::OSCUnixSocketReceiver::getDefaultPathForPort (port).toRawUTF8(), sizeof (address.sun_path) - 1);
+
+    const auto sender = ::socket (AF_UNIX, SOCK_DGRAM, 0);
+    REQUIRE (sender >= 0);
+    CHECK (::sendto (sender, valuePacket, sizeof (valuePacket), 0, reinterpret_cast<const sockaddr*> (&address), sizeof (address)) == static_cast<ssize_t> (sizeof (valuePacket)));
+    ::close (sender);
+
+    checkReceivedValuePacket (*channel);
+
+    manager.stopListening();
+    CHECK_FALSE (juce::File (address.sun_path).exists());
+}
+#endif
+
+TEST_CASE ("Receive thread options are kept in range", "[bridge]")
+{
+    const auto options = birdhouse::ReceiveThreadOptions::fromSettings (birdhouse::SchedulingFifo, 50, 3);
+    CHECK (options.policy == birdhouse::SchedulingFifo);
+    CHECK (options.priority == 50);
+    CHECK (options.affinityMask == 3u);
+    CHECK (options.wantsRealtime());
+
+    const auto tooHigh = birdhouse::ReceiveThreadOptions::fromSettings (7, 500, 0);
+    CHECK (tooHigh.policy == birdhouse::SchedulingRoundRobin);
+    CHECK (tooHigh.priority == 99);
+
+    const auto tooLow = birdhouse::ReceiveThreadOptions::fromSettings (-1, 0, 0);
+    CHECK (tooLow.policy == birdhouse::SchedulingNormal);
+    CHECK (tooLow.priority == 1);
+    CHECK_FALSE (tooLow.wantsRealtime());
+}
+
+TEST_CASE ("OSC arrives over UDP on the receive thread", "[bridge]")
+{
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 48, birdhouse::MidiCC);
+    birdhouse::OSCBridgeManager manager ({ channel });
+    manager.addTransport<birdhouse::OSCUDPReceiver>();
+
+    SECTION ("with normal scheduling")
+    {
+        manager.setReceiveThreadOptions ({});
+    }
+
+    SECTION ("with realtime scheduling, or the fallback without permission for it")
+    {
+        manager.setReceiveThreadOptions (birdhouse::ReceiveThreadOptions::fromSettings (birdhouse::SchedulingFifo, 80, 0));
+    }
+
+    constexpr auto port = 47814;
+    REQUIRE (manager.startListening (port));
+
+    juce::DatagramSocket sender;
+    CHECK (sender.write ("127.0.0.1", port, valuePacket, sizeof (valuePacket)) == static_cast<int> (sizeof (valuePacket)));
+
+    checkReceivedValuePacket (*channel);
+
+    manager.stopListening();
+    CHECK_FALSE (manager.isReceiveThreadRealtime());
+}
+
+TEST_CASE ("SLIP framed OSC arrives over TCP", "[bridge]")
+{
+    using Decoder = birdhouse::SLIPDecoder<>;
+
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 48, birdhouse::MidiCC);
+    birdhouse::OSCBridgeManager manager ({ channel });
+    manager.addTransport<birdhouse::OSCTCPReceiver>();
+
+    constexpr auto port = 47815;
+    REQUIRE (manager.startListening (port));
+
+    juce::StreamingSocket sender;
+    REQUIRE (sender.connect ("127.0.0.1", port, 2000));
+
+    // Split in two writes, which the receiver reassembles
+    std::vector<std::uint8_t> frame { Decoder::END };
+    frame.insert (frame.end(), valuePacket, valuePacket + sizeof (valuePacket));
+    frame.push_back (Decoder::END);
+
+    CHECK (sender.write (frame.data(), 7) == 7);
+    CHECK (sender.write (frame.data() + 7, static_cast<int> (frame.size()) - 7) == static_cast<int> (frame.size()) - 7);
+
+    checkReceivedValuePacket (*channel);
+
+    sender.close();
+    manager.stopListening();
+}
+
+#if BIRDHOUSE_HAS_VIRTUAL_MIDI_PORTS
+TEST_CASE ("Direct MIDI output releases the notes it sent", "[bridge]")
+{
+    auto gui = juce::ScopedJuceInitialiser_GUI {};
+    birdhouse::DirectMidiOutput output;
+
+    // Creating the port needs a MIDI system, e.g. the ALSA sequencer, which build machines often lack
+    if (!output.open ("BirdHouse"))
+    {
+        WARN ("No virtual MIDI port could be created, skipping");
+        return;
+    }
+
+    CHECK (output.getName() == "BirdHouse");
+    CHECK (output.getChannelsWithNotes() == 0);
+
+    output.send (birdhouse::MidiEvent::noteOn (3, 60, 100));
+    CHECK (output.getChannelsWithNotes() == 1u << 2);
+
+    // A velocity 0 note on is a note off
+    output.send (birdhouse::MidiEvent::noteOn (5, 60, 0));
+    output.send (birdhouse::MidiEvent::noteOff (6, 60));
+    CHECK (output.getChannelsWithNotes() == 1u << 2);
+
+    output.send (birdhouse::MidiEvent::noteOn (16, 72, 1));
+    CHECK (output.getChannelsWithNotes() == ((1u << 2) | (1u << 15)));
+    CHECK (output.getNumEventsSent() == 4);
+
+    output.close();
+    CHECK_FALSE (output.isOpen());
+    CHECK (output.getChannelsWithNotes() == 0);
+}
+#endif
+
+TEST_CASE ("High resolution MIDI encoding", "[bridge]")
+{
+    birdhouse::HighResolutionMidiEncoder encoder;
+    std::vector<birdhouse::MidiEvent> sent;
+    auto sink = [&sent] (const birdhouse::MidiEvent& event) { sent.push_back (event); };
+
+    SECTION ("14 bit CC skips unchanged parts")
+    {
+        encoder.encodeController (0.25f, 1, 1, sink);
+        REQUIRE (sent.size() == 2);
+        CHECK (sent[0].data1() == 1);
+        CHECK (sent[1].data1() == 33);
+
+        // Same value, nothing to send
+        sent.clear();
+        encoder.encodeController (0.25f, 1, 1, sink);
+        CHECK (sent.empty());
+
+        // Only the LSB changes
+        encoder.encodeController (0.25f + 1.0f / birdhouse::HighResolutionMidiEncoder::maxValue, 1, 1, sink);
+        REQUIRE (sent.size() == 1);
+        CHECK (sent[0].data1() == 33);
+    }
+
+    SECTION ("NRPN selects the parameter once")
+    {
+        birdhouse::MidiParameterSelection selection;
+
+        encoder.encodeParameter (0.25f, 1, 300, false, selection, sink);
+        REQUIRE (sent.size() == 4);
+        CHECK (sent[0].data1() == 99);
+        CHECK (sent[0].data2() == 2);
+        CHECK (sent[1].data1() == 98);
+        CHECK (sent[1].data2() == 44);
+
+        sent.clear();
+        encoder.encodeParameter (0.75f, 1, 300, false, selection, sink);
+        REQUIRE (sent.size() == 2);
+        CHECK (sent[0].data1() == 6);
+        CHECK (sent[1].data1() == 38);
+    }
+}
+
+TEST_CASE ("MIDI 2.0 packets are packed and downconverted", "[bridge]")
+{
+    using Bytes = std::vector<juce::uint8>;
+    namespace ump = birdhouse::ump;
+
+    ump::Midi1Downconverter downconverter;
+    std::vector<Bytes> messages;
+    const auto convert = [&] (const ump::Packet64& packet) {
+        messages.clear();
+        downconverter.convert (&packet, 1, [&messages] (const juce::uint8* bytes, int numBytes) { messages.emplace_back (bytes, bytes + numBytes); });
+    };
+
+    SECTION ("notes")
+    {
+        const auto noteOn = ump::makeNoteOn (2, 60, 0xffff);
+        CHECK (noteOn.word0 == 0x40913c00);
+        CHECK (noteOn.word1 == 0xffff0000);
+
+        convert (noteOn);
+        REQUIRE (messages.size() == 1);
+        CHECK (messages[0] == Bytes { 0x91, 60, 127 });
+
+        // A velocity that scales down to 0 would be a note off in MIDI 1.0
+        convert (ump::makeNoteOn (2, 60, 0x0100));
+        REQUIRE (messages.size() == 1);
+        CHECK (messages[0] == Bytes { 0x91, 60, 1 });
+
+        convert (ump::makeNoteOff (2, 60, 0));
+        REQUIRE (messages.size() == 1);
+        CHECK (messages[0] == Bytes { 0x81, 60, 0 });
+    }
+
+    SECTION ("pitch bend keeps the top 14 bits, LSB first")
+    {
+        // 0x2001 in the top 14 bits
+        convert (ump::makePitchBend (1, 0x80040000));
+        REQUIRE (messages.size() == 1);
+        CHECK (messages[0] == Bytes { 0xe0, 0x01, 0x40 });
+    }
+
+    SECTION ("program change and channel pressure are two bytes")
+    {
+        const auto program = ump::makeProgramChange (3, 42);
+        CHECK (program.word0 == 0x40c20000);
+        CHECK (program.word1 == 0x2a000000);
+
+        convert (program);
+        REQUIRE (messages.size() == 1);
+        CHECK (messages[0] == Bytes { 0xc2, 42 });
+
+        convert (ump::makeChannelPressure (4, 0x80000000));
+        REQUIRE (messages.size() == 1);
+        CHECK (messages[0] == Bytes { 0xd3, 64 });
+    }
+
+    SECTION ("NRPN and RPN select the parameter, then send the value as data entry")
+    {
+        // Parameter 393 is bank 3, index 9
+        const auto nrpn = ump::makeParameter (5, 393, false, 0x80040000);
+        CHECK (nrpn.word0 == 0x40340309);
+
+        convert (nrpn);
+        REQUIRE (messages.size() == 4);
+        CHECK (messages[0] == Bytes { 0xb4, 99, 3 });
+        CHECK (messages[1] == Bytes { 0xb4, 98, 9 });
+        CHECK (messages[2] == Bytes { 0xb4, 6, 0x40 });
+        CHECK (messages[3] == Bytes { 0xb4, 38, 0x01 });
+
+        convert (ump::makeParameter (5, 393, true, 0x80040000));
+        REQUIRE (messages.size() == 4);
+        CHECK (messages[0] == Bytes { 0xb4, 101, 3 });
+        CHECK (messages[1] == Bytes { 0xb4, 100, 9 });
+    }
+}
+
+TEST_CASE ("High resolution types keep their resolution with MIDI 2.0 output", "[bridge]")
+{
+    juce::MidiBuffer midi;
+
+    SECTION ("CC 14-bit sends MSB and LSB")
+    {
+        auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 7, birdhouse::MidiCC14);
+        channel->state().setMidi2Output (true);
+
+        // 0.25 is 4096 of 16383, MSB 32 and LSB 0. Then only the LSB moves.
+        channel->handleOSCMessage (juce::OSCMessage ("/1/value", 0.25f));
+        channel->handleOSCMessage (juce::OSCMessage ("/1/value", 0.25f + 1.0f / birdhouse::HighResolutionMidiEncoder::maxValue));
+        channel->appendMessagesTo (midi);
+        channel->appendUMPAsMidi1To (midi);
+
+        std::vector<std::pair<int, int>> controllers;
+        for (const auto metadata : midi)
+        {
+            const auto message = metadata.getMessage();
+            controllers.emplace_back (message.getControllerNumber(), message.getControllerValue());
+        }
+
+        CHECK (controllers == std::vector<std::pair<int, int>> { { 7, 32 }, { 39, 0 }, { 39, 1 } });
+    }
+
+    SECTION ("NRPN selects the parameter once")
+    {
+        auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 300, birdhouse::MidiNRPN);
+        channel->state().setMidi2Output (true);
+
+        channel->handleOSCMessage (juce::OSCMessage ("/1/value", 0.25f));
+        channel->handleOSCMessage (juce::OSCMessage ("/1/value", 0.75f));
+        channel->appendMessagesTo (midi);
+        channel->appendUMPAsMidi1To (midi);
+
+        // Select, then two data entries of MSB and LSB
+        REQUIRE (midi.getNumEvents() == 6);
+        CHECK ((*midi.begin()).getMessage().getControllerNumber() == 99);
+    }
+}
+
+TEST_CASE ("Stale notes are released on mapping changes", "[bridge]")
+{
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 60, birdhouse::MidiNote);
+    juce::MidiBuffer midi;
+
+    channel->handleOSCMessage (juce::OSCMessage ("/1/value", 1.0f));
+    channel->appendMessagesTo (midi);
+    REQUIRE (midi.getNumEvents() == 1);
+
+    // Writing the same mapping again is not a change
+    channel->state().setOutputMidiNum (60);
+    CHECK_FALSE (channel->state().consumeMidiChanged());
+
+    midi.clear();
+    channel->state().setOutputMidiNum (61);
+    REQUIRE (channel->state().consumeMidiChanged());
+    channel->releaseStaleNotes (midi);
+
+    REQUIRE (midi.getNumEvents() == 1);
+    const auto message = (*midi.begin()).getMessage();
+    CHECK (message.isNoteOff());
+    CHECK (message.getNoteNumber() == 60);
+}
+
+TEST_CASE ("MPE touches get their own member channel", "[bridge]")
+{
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/touch", 0.0f, 1.0f, 1, 60, birdhouse::MidiMPE);
+    juce::MidiBuffer midi;
+
+    CHECK (channel->matchesPath ("/touch/3"));
+    CHECK_FALSE (channel->matchesPath ("/touch"));
+    CHECK_FALSE (channel->matchesPath ("/touchpad/3"));
+
+    channel->handleOSCMessage (juce::OSCMessage ("/touch/0", 0.5f, 0.5f, 1.0f));
+    channel->handleOSCMessage (juce::OSCMessage ("/touch/1", 0.5f, 0.5f, 1.0f));
+    channel->appendMPETo (midi);
+
+    // Configuration message, then bend, timbre, pressure and note on for each touch
+    REQUIRE (midi.getNumEvents() == 5 + 2 * 4);
+
+    std::vector<juce::MidiMessage> noteOns;
+    for (const auto metadata : midi)
+    {
+        if (metadata.getMessage().isNoteOn())
+        {
+            noteOns.push_back (metadata.getMessage());
+        }
+    }
+
+    REQUIRE (noteOns.size() == 2);
+    CHECK (noteOns[0].getChannel() == 2);
+    CHECK (noteOns[1].getChannel() == 3);
+    CHECK (noteOns[0].getNoteNumber() == 60);
+
+    // Moving a touch only sends what changed, releasing it frees the channel
+    midi.clear();
+    channel->handleOSCMessage (juce::OSCMessage ("/touch/1", 0.75f, 0.5f, 1.0f));
+    channel->handleOSCMessage (juce::OSCMessage ("/touch/0", 0.5f, 0.5f, 0.0f));
+    channel->appendMPETo (midi);
+
+    auto numNoteOffs = 0;
+    for (const auto metadata : midi)
+    {
+        const auto message = metadata.getMessage();
+
+        if (message.isPitchWheel() && message.getChannel() == 3)
+        {
+            CHECK (message.getPitchWheelValue() > 8192);
+        }
+
+        numNoteOffs += message.isNoteOff() ? 1 : 0;
+    }
+
+    CHECK (numNoteOffs == 1);
+
+    midi.clear();
+    channel->handleOSCMessage (juce::OSCMessage ("/touch/2", 0.5f, 0.5f, 1.0f));
+    channel->appendMPETo (midi);
+
+    for (const auto metadata : midi)
+    {
+        if (metadata.getMessage().isNoteOn())
+        {
+            CHECK (metadata.getMessage().getChannel() == 2);
+        }
+    }
+}
+
+TEST_CASE ("MPE channels share the member channels of their zone", "[bridge]")
+{
+    auto pool = std::make_shared<birdhouse::MPEVoicePool>();
+    auto lower = std::make_shared<birdhouse::OSCBridgeChannel> ("/a", 0.0f, 1.0f, 1, 60, birdhouse::MidiMPE);
+    auto upper = std::make_shared<birdhouse::OSCBridgeChannel> ("/b", 0.0f, 1.0f, 16, 60, birdhouse::MidiMPE);
+    lower->setMPEVoicePool (pool);
+    upper->setMPEVoicePool (pool);
+    pool->setZonesInUse (true, true);
+
+    auto noteOnChannels = [] (const juce::MidiBuffer& midi) {
+        std::vector<int> channels;
+        for (const auto metadata : midi)
+        {
+            if (metadata.getMessage().isNoteOn())
+            {
+                channels.push_back (metadata.getMessage().getChannel());
+            }
+        }
+        return channels;
+    };
+
+    juce::MidiBuffer midi;
+    lower->handleOSCMessage (juce::OSCMessage ("/a/0", 0.5f, 0.5f, 1.0f));
+    upper->handleOSCMessage (juce::OSCMessage ("/b/0", 0.5f, 0.5f, 1.0f));
+    lower->appendMPETo (midi);
+    upper->appendMPETo (midi);
+    CHECK (noteOnChannels (midi) == std::vector<int> { 2, 15 });
+
+    // A mapping change releases the voices and gives their channels back
+    midi.clear();
+    lower->releaseStaleNotes (midi);
+    REQUIRE (midi.getNumEvents() == 1);
+    CHECK ((*midi.begin()).getMessage().isNoteOff());
+
+    midi.clear();
+    lower->handleOSCMessage (juce::OSCMessage ("/a/1", 0.5f, 0.5f, 1.0f));
+    lower->appendMPETo (midi);
+    CHECK (noteOnChannels (midi) == std::vector<int> { 2 });
+}
+
+TEST_CASE ("Pressure and program change are not repeated", "[bridge]")
+{
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 127.0f, 3, 60, birdhouse::MidiProgramChange);
+    juce::MidiBuffer midi;
+
+    channel->handleOSCMessage (juce::OSCMessage ("/1/value", 42.0f));
+    channel->handleOSCMessage (juce::OSCMessage ("/1/value", 42.0f));
+    channel->appendMessagesTo (midi);
+
+    REQUIRE (midi.getNumEvents() == 1);
+    const auto programChange = (*midi.begin()).getMessage();
+    CHECK (programChange.isProgramChange());
+    CHECK (programChange.getProgramChangeNumber() == 42);
+    CHECK (programChange.getChannel() == 3);
+
+    midi.clear();
+    channel->state().setOutputType (birdhouse::MidiPolyPressure);
+    channel->handleOSCMessage (juce::OSCMessage ("/1/value", 42.0f));
+    channel->appendMessagesTo (midi);
+
+    REQUIRE (midi.getNumEvents() == 1);
+    const auto aftertouch = (*midi.begin()).getMessage();
+    CHECK (aftertouch.isAftertouch());
+    CHECK (aftertouch.getNoteNumber() == 60);
+    CHECK (aftertouch.getAfterTouchValue() == 42);
+}
+
+TEST_CASE ("Incoming MIDI is merged with the bridge output", "[bridge]")
+{
+    birdhouse::MidiThru thru;
+    thru.prepare (1024);
+
+    juce::MidiBuffer host;
+    host.addEvent (juce::MidiMessage::noteOn (1, 64, 0.5f), 0);
+    host.addEvent (juce::MidiMessage::controllerEvent (2, 7, 100), 10);
+    host.addEvent (juce::MidiMessage::noteOn (3, 65, 0.5f), 20);
+
+    thru.setChannelMask (0xffff & ~(1 << 2));
+    thru.setTypeMask (birdhouse::ThruAllTypes & ~birdhouse::ThruControllers);
+
+    thru.takeInput (host);
+    REQUIRE (host.isEmpty());
+
+    // What the bridge writes during the block
+    host.addEvent (juce::MidiMessage::controllerEvent (1, 1, 42), 5);
+    thru.mergeInto (host);
+
+    // The controller and channel 3 are filtered out, the rest is in timestamp order
+    REQUIRE (host.getNumEvents() == 2);
+    auto it = host.begin();
+    CHECK ((*it).samplePosition == 0);
+    CHECK ((*it).getMessage().isNoteOn());
+    ++it;
+    CHECK ((*it).samplePosition == 5);
+    CHECK ((*it).getMessage().isController());
+}
+
+TEST_CASE ("MIDI maps back to the normalized value of a channel", "[bridge]")
+{
+    using Converter = birdhouse::MidiMessageConverter;
+
+    const auto controller = birdhouse::MidiEvent::controller (2, 7, 127);
+    CHECK (Converter::toNormalizedValue (controller, birdhouse::MidiCC, 2, 7) == 1.0f);
+    CHECK_FALSE (Converter::toNormalizedValue (controller, birdhouse::MidiCC, 2, 8).has_value());
+    CHECK_FALSE (Converter::toNormalizedValue (controller, birdhouse::MidiCC, 1, 7).has_value());
+
+    const auto noteOff = birdhouse::MidiEvent::noteOff (1, 60, 64);
+    CHECK (Converter::toNormalizedValue (noteOff, birdhouse::MidiNote, 1, 60) == 0.0f);
+
+    const auto bend = birdhouse::MidiEvent::pitchBend (1, 16383);
+    CHECK (Converter::toNormalizedValue (bend, birdhouse::MidiBend, 1, 0) == 1.0f);
+
+    const auto program = birdhouse::MidiEvent::programChange (1, 0);
+    CHECK (Converter::toNormalizedValue (program, birdhouse::MidiProgramChange, 1, 0) == 0.0f);
+    CHECK_FALSE (Converter::toNormalizedValue (program, birdhouse::MidiNRPN, 1, 0).has_value());
+}
+
+TEST_CASE ("CC glides are spread over the block", "[bridge]")
+{
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 7, birdhouse::MidiCC);
+    channel->prepare (1000.0);
+    channel->state().setGlideTime (64.0f);
+    juce::MidiBuffer midi;
+
+    // The first block only picks up where the channel is
+    channel->appendGlideTo (midi, 64, 125.0f, [] (const juce::uint8*, int, int) {});
+    REQUIRE (midi.isEmpty());
+
+    channel->handleOSCMessage (juce::OSCMessage ("/1/value", 1.0f));
+    channel->appendMessagesTo (midi);
+    REQUIRE (midi.isEmpty());
+
+    // 64 ms at 125 steps per second is 8 steps, 8 samples apart, ending on the new value
+    channel->appendGlideTo (midi, 64, 125.0f, [] (const juce::uint8*, int, int) {});
+    REQUIRE (midi.getNumEvents() == 8);
+
+    auto lastPosition = -1;
+    auto lastValue = -1;
+    for (const auto metadata : midi)
+    {
+        CHECK (metadata.samplePosition - lastPosition == 8);
+        lastPosition = metadata.samplePosition;
+        lastValue = metadata.getMessage().getControllerValue();
+    }
+
+    CHECK (lastValue == 127);
+
+    SECTION ("towards the value after the expression")
+    {
+        channel->state().setExpression ("1 - x");
+        channel->handleOSCMessage (juce::OSCMessage ("/1/value", 0.25f));
+        midi.clear();
+
+        channel->appendGlideTo (midi, 64, 125.0f, [] (const juce::uint8*, int, int) {});
+        REQUIRE_FALSE (midi.isEmpty());
+
+        for (const auto metadata : midi)
+        {
+            lastValue = metadata.getMessage().getControllerValue();
+        }
+
+        CHECK (lastValue == 95);
+    }
+}
+
+TEST_CASE ("Control signals ramp to their target", "[bridge]")
+{
+    birdhouse::ControlSignalOutput output;
+    output.setSmoothingTime (10.0f);
+
+    // 10 ms at 1 kHz is a 10 sample ramp, longer than the 4 sample blocks the output is prepared for
+    output.prepare (1000.0, 4, 1);
+
+    std::array<float, 16> signal {};
+
+    // The first block starts on the value, without a ramp
+    output.render (0, 0.5f, signal.data(), 4);
+    for (auto i = 0; i < 4; ++i)
+    {
+        CHECK (signal[static_cast<std::size_t> (i)] == 0.5f);
+    }
+
+    // From 0.5 to 1 in 10 steps of 0.05, then holding
+    const auto checkRamp = [&signal] (int firstSample, int numSamples)
+    {
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            const auto sample = firstSample + i;
+            const auto expected = sample < 10 ? 0.5f + 0.05f * static_cast<float> (sample + 1) : 1.0f;
+            CHECK (std::abs (signal[static_cast<std::size_t> (i)] - expected) < 0.0001f);
+        }
+    };
+
+    SECTION ("over several blocks")
+    {
+        for (auto block = 0; block < 4; ++block)
+        {
+            output.render (0, 1.0f, signal.data(), 4);
+            checkRamp (block * 4, 4);
+        }
+
+        CHECK (signal[3] == 1.0f);
+    }
+
+    SECTION ("in a block longer than the prepared size")
+    {
+        output.render (0, 1.0f, signal.data(), 16);
+        checkRamp (0, 16);
+        CHECK (signal[15] == 1.0f);
+    }
+
+    SECTION ("to a new target mid-ramp")
+    {
+        output.render (0, 1.0f, signal.data(), 4);
+        checkRamp (0, 4);
+
+        // A full new ramp from where the old one got to, 0.7, down to 0
+        output.render (0, 0.0f, signal.data(), 16);
+        for (auto i = 0; i < 16; ++i)
+        {
+            const auto expected = i < 10 ? 0.7f - 0.07f * static_cast<float> (i + 1) : 0.0f;
+            CHECK (std::abs (signal[static_cast<std::size_t> (i)] - expected) < 0.0001f);
+        }
+
+        CHECK (signal[15] == 0.0f);
+    }
+}
+
+TEST_CASE ("Automation output is throttled", "[bridge]")
+{
+    struct WriteCounter : juce::AudioProcessorParameter::Listener
+    {
+        void parameterValueChanged (int, float) override { ++numWrites; }
+        void parameterGestureChanged (int, bool) override {}
+
+        int numWrites { 0 };
+    };
+
+    juce::AudioParameterFloat parameter ("Value1", "Value1", 0.f, 1.f, 0.f);
+    WriteCounter counter;
+    parameter.addListener (&counter);
+
+    birdhouse::HostParameterOutput output;
+    output.addParameter (&parameter);
+    output.setMinimumInterval (20.0f);
+
+    // 20 ms at 1 kHz is 20 samples between writes
+    output.prepare (1000.0);
+
+    // The first value goes out straight away
+    output.write (0, 0.5f, 64);
+    REQUIRE (counter.numWrites == 1);
+    CHECK (parameter.get() == 0.5f);
+
+    SECTION ("at most once per minimum interval")
+    {
+        output.write (0, 0.6f, 10);
+        CHECK (counter.numWrites == 1);
+
+        // Still waiting, and the latest value is the one that goes out
+        output.write (0, 0.7f, 9);
+        CHECK (counter.numWrites == 1);
+
+        output.write (0, 0.7f, 1);
+        CHECK (counter.numWrites == 2);
+        CHECK (parameter.get() == 0.7f);
+    }
+
+    SECTION ("changes that are too small are skipped")
+    {
+        output.write (0, 0.5f + 1.0f / 2048.0f, 64);
+        CHECK (counter.numWrites == 1);
+
+        output.write (0, 0.6f, 64);
+        CHECK (counter.numWrites == 2);
+    }
+
+    SECTION ("without an interval every block can write")
+    {
+        output.setMinimumInterval (0.0f);
+
+        output.write (0, 0.6f, 1);
+        output.write (0, 0.7f, 1);
+        CHECK (counter.numWrites == 3);
+    }
+
+    SECTION ("prepare lets the next value out at once")
+    {
+        output.write (0, 0.6f, 1);
+        CHECK (counter.numWrites == 1);
+
+        output.prepare (1000.0);
+        output.write (0, 0.6f, 1);
+        CHECK (counter.numWrites == 2);
+    }
+
+    parameter.removeListener (&counter);
+}
+
+TEST_CASE ("Smoothed channels drop spikes and repeats", "[bridge]")
+{
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 7, birdhouse::MidiCC);
+    channel->state().setSmoothingMode (birdhouse::SmoothingMedian);
+    juce::MidiBuffer midi;
+
+    // The spike is outvoted by its neighbours, and the values around it are the same CC value
+    for (const auto value : { 0.5f, 0.5f, 1.0f, 0.5f, 0.501f })
+    {
+        channel->handleOSCMessage (juce::OSCMessage ("/1/value", value));
+    }
+
+    channel->appendMessagesTo (midi);
+
+    REQUIRE (midi.getNumEvents() == 1);
+    CHECK ((*midi.begin()).getMessage().getControllerValue() == 63);
+}
+
+TEST_CASE ("Response curves reshape the normalized value", "[bridge]")
+{
+    birdhouse::OSCBridgeChannelState state ("/1/value", 0.0f, 10.0f, 1, 7, birdhouse::MidiCC);
+    CHECK (state.normalizeValue (5.0f) == 0.5f);
+
+    state.setResponseCurve (birdhouse::CurveExponential, 4.0f, {});
+    CHECK (state.normalizeValue (0.0f) == 0.0f);
+    CHECK (state.normalizeValue (5.0f) < 0.2f);
+    CHECK (std::abs (state.normalizeValue (10.0f) - 1.0f) < 0.001f);
+
+    // Breakpoints don't have to be in order
+    state.setResponseCurve (birdhouse::CurveBreakpoints, 4.0f, "1 1, 0 0, 0.5 0.9");
+    CHECK (std::abs (state.normalizeValue (2.5f) - 0.45f) < 0.01f);
+    CHECK (std::abs (state.normalizeValue (7.5f) - 0.95f) < 0.01f);
+
+    // Extreme amounts still give values MIDI can take
+    for (const auto type : { birdhouse::CurveExponential, birdhouse::CurveLogarithmic, birdhouse::CurveSCurve })
+    {
+        for (const auto amount : { 1000.0f, -1000.0f })
+        {
+            state.setResponseCurve (type, amount, {});
+
+            for (const auto value : { 0.0f, 2.5f, 5.0f, 10.0f })
+            {
+                const auto normalized = state.normalizeValue (value);
+                CHECK ((normalized >= 0.0f && normalized <= 1.0f));
+            }
+        }
+    }
+}
+
+TEST_CASE ("Mapping expressions transform the value", "[bridge]")
+{
+    juce::String error;
+    CHECK_FALSE (birdhouse::MappingExpression::compile ("clamp (x, 1)", error).has_value());
+    CHECK (error.isNotEmpty());
+
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 7, birdhouse::MidiCC);
+    juce::MidiBuffer midi;
+
+    channel->state().setExpression ("1 - x");
+    channel->handleOSCMessage (juce::OSCMessage ("/1/value", 0.25f));
+
+    // The CV and automation outputs follow the transformed value, like the MIDI
+    CHECK (channel->getOutputValue() == 0.75f);
+
+    // With y in it, a message with two arguments is taken as well
+    channel->state().setExpression ("max (x, y)");
+    channel->handleOSCMessage (juce::OSCMessage ("/1/value", 0.0f, 1.0f));
+    channel->appendMessagesTo (midi);
+
+    REQUIRE (midi.getNumEvents() == 2);
+    auto it = midi.begin();
+    CHECK ((*it).getMessage().getControllerValue() == 95);
+    ++it;
+    CHECK ((*it).getMessage().getControllerValue() == 127);
+}
+
+TEST_CASE ("Rate limited controllers keep the latest value", "[bridge]")
+{
+    birdhouse::MidiRateLimiter<1> limiter;
+    limiter.prepare (1000.0);
+    limiter.setChannelRate (0, 100.0f);
+
+    // 100 per second allows a burst of 5
+    limiter.refill (1000);
+    auto numAdmitted = 0;
+    for (auto value = 0; value < 8; ++value)
+    {
+        const auto event = birdhouse::MidiEvent::controller (1, 7, value);
+        numAdmitted += limiter.admit (0, event.bytes.data(), event.numBytes) ? 1 : 0;
+    }
+
+    CHECK (numAdmitted == 5);
+    CHECK (limiter.getNumLimited (0) == 3);
+
+    auto flushed = birdhouse::MidiEvent();
+    limiter.flushPending (0, [&flushed] (const birdhouse::MidiEvent& event) { flushed = event; });
+    CHECK (flushed.isEmpty());
+
+    // 10 ms later there is room for one more, which is the last value
+    limiter.refill (10);
+    limiter.flushPending (0, [&flushed] (const birdhouse::MidiEvent& event) { flushed = event; });
+    CHECK (flushed == birdhouse::MidiEvent::controller (1, 7, 7));
+}
+
+TEST_CASE ("Notes go out before queued controllers", "[bridge]")
+{
+    auto channel = std::make_shared<birdhouse::OSCBridgeChannel> ("/1/value", 0.0f, 1.0f, 1, 7, birdhouse::MidiCC);
+    juce::MidiBuffer midi;
+
+    for (auto value = 0; value < 10; ++value)
+    {
+        channel->addMidiEvent (birdhouse::MidiEvent::controller (1, 7, value));
+    }
+    channel->addMidiEvent (birdhouse::MidiEvent::noteOn (1, 60, 100));
+
+    channel->appendPriorityMessagesTo (midi, 0, [] (const juce::uint8*, int, int) {});
+
+    // Over a budget of 3 messages, the controllers after it are coalesced to the latest
+    auto numWritten = 1;
+    channel->appendControllerMessagesTo (
+        midi, 0, [&numWritten] (const juce::uint8*, int, int) { ++numWritten; }, [] (const juce::uint8*, int) { return true; }, [&numWritten] { return numWritten >= 3; });
+
+    REQUIRE (midi.getNumEvents() == 4);
+    auto it = midi.begin();
+    CHECK ((*it).getMessage().isNoteOn());
+    CHECK ((*++it).getMessage().getControllerValue() == 0);
+    CHECK ((*++it).getMessage().getControllerValue() == 1);
+    CHECK ((*++it).getMessage().getControllerValue() == 9);
+}
+
+TEST_CASE ("Scenes switch every channel's mapping at once", "[bridge]")
+{
+    std::vector<std::shared_ptr<birdhouse::OSCBridgeChannel>> channels {
+        std::make_shared<birdhouse::OSCBridgeChannel> ("/a", 0.0f, 1.0f, 1, 7, birdhouse::MidiCC),
+        std::make_shared<birdhouse::OSCBridgeChannel> ("/b", 0.0f, 1.0f, 2, 60, birdhouse::MidiNote)
+    };
+
+    birdhouse::SceneBank scenes;
+    scenes.attach (channels);
+    scenes.store (1, birdhouse::SceneBank::capture (channels));
+
+    // The channels' own settings move on, the scene keeps what was captured
+    channels[0]->state().setPath ("/c");
+    channels[0]->state().setOutputMidiChannel (5);
+    CHECK_FALSE (scenes.select (2));
+
+    REQUIRE (scenes.select (1));
+    CHECK (scenes.getActiveSceneNumber() == 1);
+    CHECK (channels[0]->matchesPath ("/a"));
+    CHECK (channels[0]->state().outChan() == 1);
+    CHECK (channels[1]->state().outType() == birdhouse::MidiNote);
+
+    juce::MidiBuffer midi;
+    channels[0]->handleOSCMessage (juce::OSCMessage ("/a", 1.0f));
+    channels[0]->appendMessagesTo (midi);
+    REQUIRE (midi.getNumEvents() == 1);
+    CHECK ((*midi.begin()).getMessage().getChannel() == 1);
+
+    REQUIRE (scenes.select (0));
+    CHECK (channels[0]->matchesPath ("/c"));
+    CHECK (channels[0]->state().outChan() == 5);
+
+    SECTION ("removing the playing scene goes back to the channels' own settings")
+    {
+        REQUIRE (scenes.select (1));
+        const auto numSwitches = scenes.getNumSwitches();
+
+        scenes.remove (1);
+        CHECK (scenes.getActiveSceneNumber() == 0);
+        CHECK (scenes.getNumSwitches() != numSwitches);
+        CHECK (channels[0]->matchesPath ("/c"));
+        CHECK_FALSE (scenes.hasScene (1));
+        CHECK_FALSE (scenes.select (1));
+    }
+}
+
+TEST_CASE ("Morphing crossfades values and ranges between two scenes", "[bridge]")
+{
+    birdhouse::Scene from, to;
+    from.channels.push_back ({ "/a", 0.0f, 1.0f, 1, 48, birdhouse::MidiCC, false, 0.2f });
+    to.channels.push_back ({ "/a", 0.0f, 3.0f, 1, 48, birdhouse::MidiCC, false, 1.0f });
+
+    birdhouse::SceneMorph<1> morph;
+    morph.setScenes (&from, &to);
+    morph.setPosition (0.5f);
+
+    auto numStopped = 0;
+    auto stop = [&numStopped] (int) { numStopped++; };
+
+    auto value = 0.f, inMax = 0.f;
+    REQUIRE (morph.process ([&] (int, float newValue, float, float newInMax) {
+        value = newValue;
+        inMax = newInMax;
+    },
+        stop));
+    CHECK (std::abs (value - 0.6f) < 1.0e-6f);
+    CHECK (std::abs (inMax - 2.0f) < 1.0e-6f);
+
+    // Nothing to do until the position moves
+    CHECK_FALSE (morph.process ([] (int, float, float, float) {}, stop));
+    morph.setPosition (2.0f);
+    REQUIRE (morph.process ([&] (int, float newValue, float, float) { value = newValue; }, stop));
+    CHECK (std::abs (value - 1.0f) < 1.0e-6f);
+
+    // Without a pair of scenes the channels are handed back once
+    morph.setScenes (&from, nullptr);
+    CHECK_FALSE (morph.process ([] (int, float, float, float) {}, stop));
+    CHECK_FALSE (morph.process ([] (int, float, float, float) {}, stop));
+    CHECK (numStopped == 1);
+}
+
+TEST_CASE ("Scheduled note offs land on their sample", "[bridge]")
+{
+    birdhouse::NoteOffScheduler scheduler;
+    scheduler.prepare (1000.0);
+
+    const juce::uint8 noteOn[3] = { 0x90, 60, 100 };
+    scheduler.handleWrittenMessage (0, noteOn, 3, 10, 1000.0f);
+
+    auto firedAt = -1;
+    auto time = 0;
+    auto advance = [&] (int numSamples) {
+        scheduler.advance (numSamples, [&] (int, const birdhouse::MidiEvent& noteOff, int sampleOffset) {
+            CHECK (noteOff.data1() == 60);
+            firedAt = time + sampleOffset;
+        });
+        time += numSamples;
+    };
+
+    SECTION ("across blocks")
+    {
+        for (auto block = 0; block < 4; ++block)
+        {
+            advance (512);
+        }
+
+        CHECK (firedAt == 1010);
+    }
+
+    SECTION ("after a sample rate change, the same time later")
+    {
+        advance (510);
+        scheduler.prepare (2000.0);
+
+        for (auto block = 0; block < 4; ++block)
+        {
+            advance (512);
+        }
+
+        CHECK (firedAt == 510 + 1000);
+        CHECK (scheduler.getNumPending() == 0);
+    }
+}